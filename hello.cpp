@@ -1,162 +1,29 @@
+#include "hello.hpp"
 #include "lib/glfw_window.hpp"
 #include "lib/render.hpp"
 #include "lib/resource.hpp"
+#include "lib/retire_queue.hpp"
 #include "lib/surface_render.hpp"
 #include "shaders/shaders.hpp"
+#include "vk/host_allocator.hpp"
 
-#include <cmath>
 #include <cstdlib>
+#include <span>
 #include <vector>
 
 using namespace volcano;
 
-struct Vertex2D {
-  float position[2];
-};
-
-struct ColorF {
-  float color[3];
-};
-
-struct Vertex2D_ColorF_pack {
-  Vertex2D position;
-  ColorF color;
-};
-
-// Never lag by more than presentation count.
-constexpr std::uint32_t max_frame_count = 2;
-
-struct SwapchainRenderContext final {
-  DECLARE_COPY_DELETE(SwapchainRenderContext);
-  DECLARE_MOVE_DELETE(SwapchainRenderContext);
-
-  SwapchainRenderContext() = delete;
-  ~SwapchainRenderContext() { device->wait_for_idle(); }
-
-  SwapchainRenderContext(::VkExtent2D geometry,
-                         const SwapchainRenderContext& previous)
-      : SwapchainRenderContext(geometry,                    //
-                               previous.vertex_buffers[0],  //
-                               previous.vertex_count,       //
-                               previous.vert_shader,        //
-                               previous.frag_shader,        //
-                               previous.swapchain,          //
-                               previous.device,             //
-                               previous.command_pool) {}
-
-  SwapchainRenderContext(::VkExtent2D geometry,                //
-                         ::VkBuffer vertex_buffer,             //
-                         std::uint32_t vertex_count,           //
-                         ::VkShaderModule vert_shader,         //
-                         ::VkShaderModule frag_shader,         //
-                         ::VkSwapchainKHR previous_swapchain,  //
-                         InOut<Device> device,                 //
-                         InOut<CommandPool> command_pool)
-      : device{device},
-        command_pool{command_pool},
-        geometry{geometry},
-        vertex_buffers{vertex_buffer},
-        vertex_count{vertex_count},
-        vert_shader{vert_shader},
-        frag_shader{frag_shader},
-        swapchain{device->create_swapchain(  //
-            geometry,                        //
-            VK_FORMAT_B8G8R8A8_UNORM,        //
-            VK_PRESENT_MODE_FIFO_KHR,        //
-            previous_swapchain)},            //
-        swapchain_image_views{swapchain.create_image_views()},
-        render_pass{device->create_render_pass(VK_FORMAT_B8G8R8A8_UNORM)},
-        framebuffers{device->create_framebuffers(  //
-            render_pass,                           //
-            swapchain_image_views)},
-        pipeline_layout{device->create_pipeline_layout()},
-        graphics_pipeline{device->create_graphics_pipeline(  //
-            vert_shader,                                     //
-            frag_shader,                                     //
-            pipeline_layout,                                 //
-            render_pass)},
-        command_buffer_block{device->allocate_command_buffer_block(  //
-            *command_pool,                                           //
-            swapchain_image_views.size())} {
-    CHECK_INVARIANT(swapchain_image_views.size() == framebuffers.size());
-
-    for (std::uint32_t i = 0; i < framebuffers.size(); ++i) {
-      auto render_pass_command_builder =
-          command_buffer_block.create_render_pass_command_builder(
-              i, render_pass, framebuffers[i], framebuffers[i].extent());
-
-      render_pass_command_builder.bind(graphics_pipeline);
-      render_pass_command_builder.bind(0, vertex_buffers,
-                                       vertex_buffer_offsets);
-      render_pass_command_builder.draw(vertex_count);
-      render_pass_command.push_back(render_pass_command_builder);
-    }
-
-    image_acquired = device->create_semaphores(max_frame_count);
-    image_rendered = device->create_semaphores(swapchain_image_views.size());
-    frame_present =
-        device->create_fences(max_frame_count, VK_FENCE_CREATE_SIGNALED_BIT);
-  }
-
-  InOut<Device> device;
-  InOut<CommandPool> command_pool;
-  ::VkExtent2D geometry;
-
-  std::array<::VkBuffer, 1> vertex_buffers;
-  std::array<::VkDeviceSize, 1> vertex_buffer_offsets{0};
-  std::uint32_t vertex_count{0};
-
-  ::VkShaderModule vert_shader;
-  ::VkShaderModule frag_shader;
-
-  Swapchain swapchain;
-  std::vector<::VkImageView> swapchain_image_views;
-  std::uint32_t frame_present_index{0};
-
-  RenderPass render_pass;
-  std::vector<Framebuffer> framebuffers;
-
-  PipelineLayout pipeline_layout;
-  GraphicsPipeline graphics_pipeline;
-
-  CommandBufferBlock command_buffer_block;
-  std::vector<::VkCommandBuffer> render_pass_command;
-
-  std::vector<Fence> frame_present;
-  std::vector<Semaphore> image_rendered;
-  std::vector<Semaphore> image_acquired;
-};
-
 int main() {
   std::cout << "Hello world " << std::endl;
 
-  const float vertex_scale = 1.6f;
-  const std::vector<std::array<float, 5>> vert2f_color3f_pack = {
-      // Counter-clockwise wound.
-      {
-          vertex_scale * 0.5f,                     // X
-          vertex_scale * std::sqrt(3.0f) * 0.25f,  // Y
-          1.0f, 0.0f, 0.0f                         // RGB
-      },
-      {
-          vertex_scale * 0.0f,                      // X
-          vertex_scale * -std::sqrt(3.0f) * 0.25f,  // Y
-          0.0f, 1.0f, 0.0f                          // RGB
-      },
-      {
-          vertex_scale * -0.5f,                    // X
-          vertex_scale * std::sqrt(3.0f) * 0.25f,  // Y
-          0.0f, 0.0f, 1.0f                         // RGB
-      }};
-  const std::size_t vertex_buffer_vertex_count = vert2f_color3f_pack.size();
-  const std::size_t vertex_buffer_byte_count =  //
-      vert2f_color3f_pack.size() *              //
-      vert2f_color3f_pack.front().size() *      //
-      sizeof(vert2f_color3f_pack.front().front());
-  const std::span<const std::byte> vertex_buffer_bytes = {
-      reinterpret_cast<const std::byte*>(vert2f_color3f_pack.data()),  //
-      vertex_buffer_byte_count                                         //
-  };
+  // Outlives every Vulkan object below.
+  vk::HostAllocator host_allocator{vk::HostAllocatorMode::COMMAND_ARENA};
+  vk::ALLOCATOR = host_allocator.callbacks();
+
+  const auto vertices = triangle_vertices();
+  const std::size_t vertex_buffer_vertex_count = vertices.size();
+  const std::span<const std::byte> vertex_buffer_bytes =
+      std::as_bytes(std::span{vertices});
 
   Window::Geometry initial_window_geometry{.width = 800, .height = 800};
   std::unique_ptr<Window> window = std::make_unique<glfw::PlatformWindow>(
@@ -167,19 +34,26 @@ int main() {
                                               DebugLevel::VERBOSE);
   auto surface = window->create_surface(instance);
   auto device = instance.create_presentation_device(surface);
+  const char* pipeline_cache_path = "hello.pipeline_cache";
+  device.load_pipeline_cache(pipeline_cache_path);
   auto vert_shader = device.create_shader_module(vertex_shader_spirv_bin);
   auto frag_shader = device.create_shader_module(fragment_shader_spirv_bin);
 
-  auto vertex_buffer = device.create_buffer(vertex_buffer_byte_count,
-                                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-  auto memory = device.allocate_device_memory(
-      vertex_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-  memory.copy_initialize(vertex_buffer_bytes);
+  auto upload_service = device.create_upload_service();
+  auto vertex_buffer = device.create_buffer(
+      vertex_buffer_bytes.size(),
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  auto memory =
+      device.allocate_device_memory(vertex_buffer, MemoryUsage::GPU_ONLY);
+  auto vertex_upload =
+      upload_service.upload(vertex_buffer, vertex_buffer_bytes);
+  upload_service.wait(vertex_upload);
 
   auto queue = device.create_queue();
-  auto command_pool = device.create_command_pool(queue.family_index());
+
+  // Frame values are the one clock for both throttling and retiring resources.
+  auto frame_pacer = device.create_frame_pacer(max_frame_count);
+  RetireQueue retire_queue;
 
   auto swapchain_render_context = std::make_unique<SwapchainRenderContext>(
       ::VkExtent2D{
@@ -192,41 +66,27 @@ int main() {
       frag_shader,                 //
       VK_NULL_HANDLE,              //
       InOut(device),               //
-      InOut(command_pool));
+      queue.family_index());
 
   window->set_renderer(device.create_surface_renderer(
-      [&swapchain_render_context]  //
+      [&swapchain_render_context, &retire_queue, &frame_pacer]  //
       (::VkExtent2D geometry) -> bool {
-        swapchain_render_context = std::make_unique<SwapchainRenderContext>(
+        auto next_context = std::make_unique<SwapchainRenderContext>(
             geometry, *swapchain_render_context);
+        retire_queue.retire(std::move(swapchain_render_context),
+                            frame_pacer.frame_value());
+        swapchain_render_context = std::move(next_context);
         return true;
       },
-      [&swapchain_render_context, &queue]() {
-        auto* context = swapchain_render_context.get();
-        CHECK_INVARIANT(context->frame_present.size() == max_frame_count);
-        CHECK_INVARIANT(context->image_acquired.size() == max_frame_count);
-        CHECK_INVARIANT(context->image_rendered.size() ==
-                        context->swapchain_image_views.size());
-
-        auto frame_index = context->frame_present_index;
-        context->frame_present_index =
-            (context->frame_present_index + 1) % context->frame_present.size();
-
-        context->frame_present[frame_index].wait();
-        auto image_index = context->swapchain.acquire_next_image(
-            context->image_acquired[frame_index]);
-
-        queue.submit(                                       //
-            context->render_pass_command[image_index],      //
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,  //
-            context->image_acquired[frame_index],           //
-            context->image_rendered[image_index],           //
-            context->frame_present[frame_index]);
-
-        context->swapchain.present(image_index, queue,
-                                   context->image_rendered[image_index]);
+      [&swapchain_render_context, &queue, &retire_queue, &frame_pacer]() {
+        render_frame(*swapchain_render_context, queue, frame_pacer,
+                     retire_queue);
       }));
 
   window->show();
+
+  device.wait_for_idle();
+  retire_queue.clear();
+  device.save_pipeline_cache(pipeline_cache_path);
 }
 
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "lib/resource.hpp"
+#include "lib/retire_queue.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace volcano {
+
+struct Vertex2D {
+  float position[2];
+};
+
+struct ColorF {
+  float color[3];
+};
+
+struct Vertex2D_ColorF_pack {
+  Vertex2D position;
+  ColorF color;
+};
+
+// Counter-clockwise wound.
+inline std::array<Vertex2D_ColorF_pack, 3> triangle_vertices() {
+  const float vertex_scale = 1.6f;
+  const float y = vertex_scale * std::sqrt(3.0f) * 0.25f;
+  return {{
+      {{vertex_scale * 0.5f, y}, {1.0f, 0.0f, 0.0f}},
+      {{vertex_scale * 0.0f, -y}, {0.0f, 1.0f, 0.0f}},
+      {{vertex_scale * -0.5f, y}, {0.0f, 0.0f, 1.0f}},
+  }};
+}
+
+// Never lag by more than presentation count.
+constexpr std::uint32_t max_frame_count = 2;
+
+struct SwapchainRenderContext final {
+  DECLARE_COPY_DELETE(SwapchainRenderContext);
+  DECLARE_MOVE_DELETE(SwapchainRenderContext);
+
+  SwapchainRenderContext() = delete;
+  ~SwapchainRenderContext() = default;
+
+  SwapchainRenderContext(::VkExtent2D geometry,
+                         const SwapchainRenderContext& previous)
+      : SwapchainRenderContext(geometry,                    //
+                               previous.vertex_buffers[0],  //
+                               previous.vertex_count,       //
+                               previous.vert_shader,        //
+                               previous.frag_shader,        //
+                               previous.swapchain,          //
+                               previous.device,             //
+                               previous.queue_family_index) {}
+
+  SwapchainRenderContext(::VkExtent2D geometry,                //
+                         ::VkBuffer vertex_buffer,             //
+                         std::uint32_t vertex_count,           //
+                         ::VkShaderModule vert_shader,         //
+                         ::VkShaderModule frag_shader,         //
+                         ::VkSwapchainKHR previous_swapchain,  //
+                         InOut<Device> device,                 //
+                         std::uint32_t queue_family_index)
+      : device{device},
+        queue_family_index{queue_family_index},
+        geometry{geometry},
+        vertex_buffers{vertex_buffer},
+        vertex_count{vertex_count},
+        vert_shader{vert_shader},
+        frag_shader{frag_shader},
+        swapchain{device->create_swapchain(  //
+            geometry,                        //
+            VK_FORMAT_B8G8R8A8_UNORM,        //
+            VK_PRESENT_MODE_FIFO_KHR,        //
+            previous_swapchain)},            //
+        swapchain_image_views{swapchain.create_image_views()},
+        render_pass{device->create_render_pass(VK_FORMAT_B8G8R8A8_UNORM)},
+        framebuffers{device->create_framebuffers(  //
+            render_pass,                           //
+            swapchain_image_views)},
+        pipeline_layout{device->find_or_create_pipeline_layout()},
+        graphics_pipeline{device->find_or_create_graphics_pipeline(  //
+            vert_shader,                                             //
+            frag_shader,                                             //
+            pipeline_layout,                                         //
+            render_pass)},
+        frame_commands{device->create_frame_command_ring(  //
+            queue_family_index,                            //
+            max_frame_count)} {
+    CHECK_INVARIANT(swapchain_image_views.size() == framebuffers.size());
+
+    image_acquired = device->create_semaphores(max_frame_count);
+    image_rendered = device->create_semaphores(swapchain_image_views.size());
+  }
+
+  InOut<Device> device;
+  std::uint32_t queue_family_index;
+  ::VkExtent2D geometry;
+
+  std::array<::VkBuffer, 1> vertex_buffers;
+  std::array<::VkDeviceSize, 1> vertex_buffer_offsets{0};
+  std::uint32_t vertex_count{0};
+
+  ::VkShaderModule vert_shader;
+  ::VkShaderModule frag_shader;
+
+  Swapchain swapchain;
+  std::vector<::VkImageView> swapchain_image_views;
+
+  RenderPass render_pass;
+  std::vector<Framebuffer> framebuffers;
+
+  // Owned by the device, and shared with earlier contexts where unchanged.
+  ::VkPipelineLayout pipeline_layout;
+  ::VkPipeline graphics_pipeline;
+
+  // Re-recorded every frame, so contents may change from frame to frame.
+  FrameCommandRing frame_commands;
+
+  std::vector<Semaphore> image_rendered;
+  std::vector<Semaphore> image_acquired;
+};
+
+// Records, submits and presents one frame of `context`. Resources retired to
+// `retire_queue` are freed once the frame pacer has moved past them.
+inline void render_frame(SwapchainRenderContext& context,  //
+                         Queue& queue,                     //
+                         FramePacer& frame_pacer,          //
+                         RetireQueue& retire_queue) {
+  CHECK_INVARIANT(context.image_acquired.size() == max_frame_count);
+  CHECK_INVARIANT(context.image_rendered.size() ==
+                  context.swapchain_image_views.size());
+
+  auto frame_index = frame_pacer.begin_frame();
+  retire_queue.collect(frame_pacer.completed_value());
+
+  auto image_index = context.swapchain.acquire_next_image(
+      context.image_acquired[frame_index]);
+
+  context.frame_commands.begin_frame(frame_index);
+  ::VkCommandBuffer render_pass_command = VK_NULL_HANDLE;
+  {
+    auto& framebuffer = context.framebuffers[image_index];
+    auto render_pass_command_builder =
+        context.frame_commands.command_buffers()
+            .create_render_pass_command_builder(
+                0, context.render_pass, framebuffer, framebuffer.extent(),
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    render_pass_command_builder.bind(context.graphics_pipeline);
+    render_pass_command_builder.set_viewport(framebuffer.extent());
+    render_pass_command_builder.set_scissor(framebuffer.extent());
+    render_pass_command_builder.bind(0, context.vertex_buffers,
+                                     context.vertex_buffer_offsets);
+    render_pass_command_builder.draw(context.vertex_count);
+    render_pass_command = render_pass_command_builder;
+  }
+
+  std::array<::VkSemaphore, 1> wait_semaphores{
+      context.image_acquired[frame_index]};
+  std::array<std::uint64_t, 1> wait_values{0};
+  std::array<::VkPipelineStageFlags, 1> wait_pipeline_stages{
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  std::array<::VkSemaphore, 2> signal_semaphores{
+      context.image_rendered[image_index], frame_pacer.timeline()};
+  std::array<std::uint64_t, 2> signal_values{0, frame_pacer.frame_value()};
+  queue.submit(render_pass_command,   //
+               wait_semaphores,       //
+               wait_values,           //
+               wait_pipeline_stages,  //
+               signal_semaphores,     //
+               signal_values);
+  frame_pacer.end_frame();
+
+  context.swapchain.present(image_index, queue,
+                            context.image_rendered[image_index]);
+}
+
+}  // namespace volcano
@@ -0,0 +1,52 @@
+// Copyright 2024 -- CONTRIBUTORS. See LICENSE.
+
+#include "lib/allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace volcano {
+namespace {
+std::atomic<std::size_t> global_allocation_count{0};
+
+void* counted_allocate(std::size_t byte_count, std::size_t byte_alignment) {
+  global_allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  // Both functions require a non-zero size; `aligned_alloc` also requires a
+  // multiple of the alignment.
+  byte_count = byte_count ? byte_count : 1;
+  void* memory =
+      byte_alignment > alignof(std::max_align_t)
+          ? std::aligned_alloc(byte_alignment,
+                               (byte_count + byte_alignment - 1) /
+                                   byte_alignment * byte_alignment)
+          : std::malloc(byte_count);
+  if (!memory) {
+    throw std::bad_alloc{};
+  }
+  return memory;
+}
+}  // namespace
+
+std::size_t allocation_count() {
+  return global_allocation_count.load(std::memory_order_relaxed);
+}
+
+}  // namespace volcano
+
+// The remaining forms (array, nothrow, sized delete) forward to these.
+void* operator new(std::size_t byte_count) {
+  return volcano::counted_allocate(byte_count, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t byte_count, std::align_val_t byte_alignment) {
+  return volcano::counted_allocate(byte_count,
+                                   static_cast<std::size_t>(byte_alignment));
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
@@ -0,0 +1,25 @@
+// Copyright 2024 -- CONTRIBUTORS. See LICENSE.
+
+#pragma once
+
+#include <cstddef>
+
+namespace volcano {
+
+// Number of global `operator new` calls made so far on any thread. Only counts
+// in binaries that link `:allocation_counter`, which replaces the global
+// allocation functions.
+std::size_t allocation_count();
+
+// Counts allocations made during the lifetime of the scope.
+class ScopedAllocationCount final {
+ public:
+  ScopedAllocationCount() : start_{allocation_count()} {}
+
+  std::size_t count() const { return allocation_count() - start_; }
+
+ private:
+  std::size_t start_ = 0;
+};
+
+}  // namespace volcano
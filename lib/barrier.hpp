@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "lib/base.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace volcano {
+
+namespace impl {
+constexpr ::VkAccessFlags2 WRITE_ACCESS_MASK =
+    VK_ACCESS_2_SHADER_WRITE_BIT |                          //
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |                //
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |        //
+    VK_ACCESS_2_TRANSFER_WRITE_BIT |                        //
+    VK_ACCESS_2_HOST_WRITE_BIT |                            //
+    VK_ACCESS_2_MEMORY_WRITE_BIT |                          //
+    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |                  //
+    VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR |      //
+    VK_ACCESS_2_TRANSFORM_FEEDBACK_WRITE_BIT_EXT |          //
+    VK_ACCESS_2_TRANSFORM_FEEDBACK_COUNTER_WRITE_BIT_EXT |  //
+    VK_ACCESS_2_COMMAND_PREPROCESS_WRITE_BIT_NV;
+}  // namespace impl
+
+//------------------------------------------------------------------------------
+// How a command uses a resource.
+struct ResourceAccess final {
+  ::VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+  ::VkAccessFlags2 access = VK_ACCESS_2_NONE;
+  ::VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;  // Images only.
+};
+
+// The scope one barrier made a write visible to.
+struct VisibleScope final {
+  ::VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+  ::VkAccessFlags2 access = VK_ACCESS_2_NONE;
+};
+
+// Synchronization state of one resource on one queue, kept by its owner and
+// updated by `BarrierRecorder`. Starts out as never written, with undefined
+// contents.
+struct ResourceState final {
+  // Of the last write or layout transition, which later accesses wait on.
+  ::VkPipelineStageFlags2 write_stages = VK_PIPELINE_STAGE_2_NONE;
+  ::VkAccessFlags2 write_access = VK_ACCESS_2_NONE;
+
+  // Of the reads since then, which the next write waits on.
+  ::VkPipelineStageFlags2 read_stages = VK_PIPELINE_STAGE_2_NONE;
+
+  // Where the last write has been made visible already, one scope per
+  // barrier: visibility holds for the access types of a barrier in its own
+  // stages only. Once full, the oldest scope is forgotten, which at worst
+  // costs a redundant barrier.
+  std::array<VisibleScope, 4> visible_scopes{};
+  std::uint32_t visible_scope_count = 0;
+
+  ::VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;  // Images only.
+};
+
+//------------------------------------------------------------------------------
+// Derives the barriers the next command needs from the accesses it declares,
+// and records them in one `vkCmdPipelineBarrier2`. Only real hazards wait:
+// reads after reads don't, and each barrier waits on exactly the stages that
+// last touched the resource rather than ALL_COMMANDS. Buffer hazards merge
+// into one global memory barrier, which drivers handle no worse than
+// per-buffer ones; images only get their own barrier to change layout.
+// Storage is reused between flushes.
+class BarrierRecorder final {
+ public:
+  DECLARE_COPY_DELETE(BarrierRecorder);
+  DECLARE_MOVE_DEFAULT(BarrierRecorder);
+
+  BarrierRecorder() = default;
+  ~BarrierRecorder() = default;
+
+  // Declares the next command's access to a buffer. Declaring the same
+  // resource again before `flush` merges both accesses.
+  void access_buffer(ResourceState& state, const ResourceAccess& access) {
+    CHECK_PRECONDITION(access.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+    declare(&state, VK_NULL_HANDLE, {}, access);
+  }
+
+  // As above, for all of `range` of `image`.
+  void access_image(::VkImage image,                         //
+                    const ::VkImageSubresourceRange& range,  //
+                    ResourceState& state,                    //
+                    const ResourceAccess& access) {
+    CHECK_PRECONDITION(image != VK_NULL_HANDLE);
+    declare(&state, image, range, access);
+  }
+
+  // Turns the declared accesses into barriers and advances their states.
+  // Returns nullptr when nothing needs to wait. The result stays valid until
+  // the next call.
+  const ::VkDependencyInfo* resolve() {
+    memory_barrier_ = ::VkMemoryBarrier2{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+    };
+    image_barriers_.clear();
+
+    for (auto&& request : requests_) {
+      resolve(request);
+    }
+    requests_.clear();
+
+    bool has_memory_barrier =
+        memory_barrier_.srcStageMask != VK_PIPELINE_STAGE_2_NONE;
+    if (!has_memory_barrier && image_barriers_.empty()) {
+      return nullptr;
+    }
+
+    dependency_info_ = ::VkDependencyInfo{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = has_memory_barrier ? 1u : 0u,
+        .pMemoryBarriers = &memory_barrier_,
+        .imageMemoryBarrierCount =
+            narrow_cast<std::uint32_t>(image_barriers_.size()),
+        .pImageMemoryBarriers = image_barriers_.data(),
+    };
+    return &dependency_info_;
+  }
+
+  // Records the barriers for everything declared since the last flush.
+  void flush(::VkCommandBuffer command_buffer) {
+    if (const ::VkDependencyInfo* dependency_info = resolve()) {
+      ::vkCmdPipelineBarrier2(command_buffer, dependency_info);
+    }
+  }
+
+ private:
+  struct Request final {
+    ResourceState* state = nullptr;
+    ::VkImage image = VK_NULL_HANDLE;
+    ::VkImageSubresourceRange range{};
+    ResourceAccess access;
+  };
+
+  void declare(ResourceState* state,                    //
+               ::VkImage image,                         //
+               const ::VkImageSubresourceRange& range,  //
+               const ResourceAccess& access) {
+    auto request = std::find_if(
+        requests_.begin(), requests_.end(),
+        [state](const Request& r) { return r.state == state; });
+    if (request == requests_.end()) {
+      requests_.push_back(Request{state, image, range, access});
+      return;
+    }
+
+    // One command can only see one layout.
+    CHECK_PRECONDITION(request->access.layout == access.layout);
+    request->access.stages |= access.stages;
+    request->access.access |= access.access;
+  }
+
+  void resolve(const Request& request) {
+    ResourceState& state = *request.state;
+    const ResourceAccess& access = request.access;
+    ::VkAccessFlags2 write_access = access.access & impl::WRITE_ACCESS_MASK;
+    bool is_transition = request.image != VK_NULL_HANDLE &&
+                         access.layout != state.layout;
+
+    ::VkPipelineStageFlags2 src_stages = VK_PIPELINE_STAGE_2_NONE;
+    ::VkAccessFlags2 src_access = VK_ACCESS_2_NONE;
+    bool needs_barrier = false;
+
+    if (write_access || is_transition) {
+      // Writes wait for every earlier access; only earlier writes need
+      // flushing.
+      src_stages = state.write_stages | state.read_stages;
+      src_access = state.write_access;
+      needs_barrier = src_stages != VK_PIPELINE_STAGE_2_NONE || is_transition;
+
+      state.write_stages = access.stages;
+      state.write_access = write_access;
+      state.read_stages = write_access ? VK_PIPELINE_STAGE_2_NONE
+                                       : access.stages;
+      state.visible_scope_count = 0;
+      if (!write_access) {
+        make_visible(state, access);
+      }
+    } else {
+      // Reads only wait for a write they haven't seen yet.
+      needs_barrier = state.write_stages != VK_PIPELINE_STAGE_2_NONE &&
+                      !is_visible(state, access);
+      if (needs_barrier) {
+        src_stages = state.write_stages;
+        src_access = state.write_access;
+        make_visible(state, access);
+      }
+      state.read_stages |= access.stages;
+    }
+
+    if (!needs_barrier) {
+      return;
+    }
+
+    // A memory barrier covers images too, as long as the layout stays.
+    if (!is_transition) {
+      memory_barrier_.srcStageMask |= src_stages;
+      memory_barrier_.srcAccessMask |= src_access;
+      memory_barrier_.dstStageMask |= access.stages;
+      memory_barrier_.dstAccessMask |= access.access;
+      return;
+    }
+
+    image_barriers_.push_back(::VkImageMemoryBarrier2{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = src_stages,
+        .srcAccessMask = src_access,
+        .dstStageMask = access.stages,
+        .dstAccessMask = access.access,
+        .oldLayout = state.layout,
+        .newLayout = access.layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = request.image,
+        .subresourceRange = request.range,
+    });
+    state.layout = access.layout;
+  }
+
+  // Whether one earlier barrier covered both the stages and the access.
+  static bool is_visible(const ResourceState& state,
+                         const ResourceAccess& access) {
+    return std::any_of(
+        state.visible_scopes.begin(),
+        state.visible_scopes.begin() + state.visible_scope_count,
+        [&access](const VisibleScope& scope) {
+          return (access.stages & ~scope.stages) == 0 &&
+                 (access.access & ~scope.access) == 0;
+        });
+  }
+
+  static void make_visible(ResourceState& state,
+                           const ResourceAccess& access) {
+    auto& scopes = state.visible_scopes;
+    if (state.visible_scope_count == scopes.size()) {
+      std::shift_left(scopes.begin(), scopes.end(), 1);
+      --state.visible_scope_count;
+    }
+    scopes[state.visible_scope_count++] = VisibleScope{
+        .stages = access.stages,
+        .access = access.access,
+    };
+  }
+
+  std::vector<Request> requests_;
+  ::VkMemoryBarrier2 memory_barrier_{};
+  std::vector<::VkImageMemoryBarrier2> image_barriers_;
+  ::VkDependencyInfo dependency_info_{};
+};
+
+}  // namespace volcano
@@ -0,0 +1,227 @@
+#include "lib/barrier.hpp"
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+
+namespace {
+constexpr ResourceAccess TRANSFER_WRITE{
+    .stages = VK_PIPELINE_STAGE_2_COPY_BIT,
+    .access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+};
+constexpr ResourceAccess COMPUTE_WRITE{
+    .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+    .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+};
+constexpr ResourceAccess VERTEX_READ{
+    .stages = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT,
+    .access = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT,
+};
+constexpr ResourceAccess INDIRECT_READ{
+    .stages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+    .access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+};
+constexpr ResourceAccess FRAGMENT_READ{
+    .stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+    .access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+    .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+};
+constexpr ResourceAccess COLOR_WRITE{
+    .stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+    .access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+    .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+};
+constexpr ::VkImageSubresourceRange COLOR_RANGE{
+    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+    .levelCount = 1,
+    .layerCount = 1,
+};
+}  // namespace
+
+TEST_CASE("BarrierRecorder") {
+  BarrierRecorder recorder;
+  ResourceState buffer_state;
+  ResourceState other_buffer_state;
+  ResourceState image_state;
+  auto image = reinterpret_cast<::VkImage>(0x1);
+
+  SECTION("ShouldNotWaitForReadsOfUnwrittenBuffers") {
+    // Under Test.
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+
+    // Postcondition.
+    REQUIRE(recorder.resolve() == nullptr);
+  }
+
+  SECTION("ShouldWaitOnlyForTheLastWriteStage") {
+    // Precondition.
+    recorder.access_buffer(buffer_state, TRANSFER_WRITE);
+    REQUIRE(recorder.resolve() == nullptr);
+
+    // Under Test.
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    REQUIRE(dependency_info->memoryBarrierCount == 1);
+    REQUIRE(dependency_info->imageMemoryBarrierCount == 0);
+    auto&& barrier = dependency_info->pMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask == VK_PIPELINE_STAGE_2_COPY_BIT);
+    REQUIRE(barrier.srcAccessMask == VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    REQUIRE(barrier.dstStageMask == VERTEX_READ.stages);
+    REQUIRE(barrier.dstAccessMask == VERTEX_READ.access);
+  }
+
+  SECTION("ShouldNotWaitAgainForVisibleWrites") {
+    // Precondition.
+    recorder.access_buffer(buffer_state, TRANSFER_WRITE);
+    recorder.resolve();
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+    recorder.resolve();
+
+    // Under Test.
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+
+    // Postcondition.
+    REQUIRE(recorder.resolve() == nullptr);
+  }
+
+  SECTION("ShouldWaitForReadsOutsideEveryVisibleScope") {
+    // Precondition.
+    constexpr ResourceAccess fragment_sampled_read{
+        .stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+        .access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+    };
+    constexpr ResourceAccess vertex_uniform_read{
+        .stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+        .access = VK_ACCESS_2_UNIFORM_READ_BIT,
+    };
+    constexpr ResourceAccess fragment_uniform_read{
+        .stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+        .access = VK_ACCESS_2_UNIFORM_READ_BIT,
+    };
+    recorder.access_buffer(buffer_state, TRANSFER_WRITE);
+    recorder.resolve();
+    recorder.access_buffer(buffer_state, fragment_sampled_read);
+    REQUIRE(recorder.resolve() != nullptr);
+    recorder.access_buffer(buffer_state, vertex_uniform_read);
+    REQUIRE(recorder.resolve() != nullptr);
+
+    // Under Test.
+    recorder.access_buffer(buffer_state, fragment_uniform_read);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    auto&& barrier = dependency_info->pMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask == VK_PIPELINE_STAGE_2_COPY_BIT);
+    REQUIRE(barrier.srcAccessMask == VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    REQUIRE(barrier.dstStageMask == fragment_uniform_read.stages);
+    REQUIRE(barrier.dstAccessMask == fragment_uniform_read.access);
+  }
+
+  SECTION("ShouldTreatTransformFeedbackAsWrite") {
+    // Precondition.
+    constexpr ResourceAccess transform_feedback_write{
+        .stages = VK_PIPELINE_STAGE_2_TRANSFORM_FEEDBACK_BIT_EXT,
+        .access = VK_ACCESS_2_TRANSFORM_FEEDBACK_WRITE_BIT_EXT,
+    };
+    recorder.access_buffer(buffer_state, transform_feedback_write);
+    recorder.resolve();
+
+    // Under Test.
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    auto&& barrier = dependency_info->pMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask == transform_feedback_write.stages);
+    REQUIRE(barrier.srcAccessMask == transform_feedback_write.access);
+  }
+
+  SECTION("ShouldWaitForReadsBeforeWriting") {
+    // Precondition.
+    recorder.access_buffer(buffer_state, TRANSFER_WRITE);
+    recorder.resolve();
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+    recorder.resolve();
+
+    // Under Test.
+    recorder.access_buffer(buffer_state, TRANSFER_WRITE);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    auto&& barrier = dependency_info->pMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask ==
+            (VK_PIPELINE_STAGE_2_COPY_BIT | VERTEX_READ.stages));
+    REQUIRE(barrier.srcAccessMask == VK_ACCESS_2_TRANSFER_WRITE_BIT);
+  }
+
+  SECTION("ShouldMergeBufferHazardsIntoOneBarrier") {
+    // Precondition.
+    recorder.access_buffer(buffer_state, COMPUTE_WRITE);
+    recorder.access_buffer(other_buffer_state, COMPUTE_WRITE);
+    recorder.resolve();
+
+    // Under Test.
+    recorder.access_buffer(buffer_state, INDIRECT_READ);
+    recorder.access_buffer(buffer_state, VERTEX_READ);
+    recorder.access_buffer(other_buffer_state, VERTEX_READ);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    REQUIRE(dependency_info->memoryBarrierCount == 1);
+    auto&& barrier = dependency_info->pMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    REQUIRE(barrier.dstStageMask ==
+            (INDIRECT_READ.stages | VERTEX_READ.stages));
+    REQUIRE(barrier.dstAccessMask ==
+            (INDIRECT_READ.access | VERTEX_READ.access));
+  }
+
+  SECTION("ShouldTransitionImagesOnFirstUse") {
+    // Under Test.
+    recorder.access_image(image, COLOR_RANGE, image_state, COLOR_WRITE);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    REQUIRE(dependency_info->memoryBarrierCount == 0);
+    REQUIRE(dependency_info->imageMemoryBarrierCount == 1);
+    auto&& barrier = dependency_info->pImageMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask == VK_PIPELINE_STAGE_2_NONE);
+    REQUIRE(barrier.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+    REQUIRE(barrier.newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    REQUIRE(image_state.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  }
+
+  SECTION("ShouldTransitionImagesBetweenWriteAndRead") {
+    // Precondition.
+    recorder.access_image(image, COLOR_RANGE, image_state, COLOR_WRITE);
+    recorder.resolve();
+
+    // Under Test.
+    recorder.access_image(image, COLOR_RANGE, image_state, FRAGMENT_READ);
+    auto* dependency_info = recorder.resolve();
+
+    // Postcondition.
+    REQUIRE(dependency_info != nullptr);
+    REQUIRE(dependency_info->imageMemoryBarrierCount == 1);
+    auto&& barrier = dependency_info->pImageMemoryBarriers[0];
+    REQUIRE(barrier.srcStageMask == COLOR_WRITE.stages);
+    REQUIRE(barrier.srcAccessMask == COLOR_WRITE.access);
+    REQUIRE(barrier.dstStageMask == FRAGMENT_READ.stages);
+    REQUIRE(barrier.oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    REQUIRE(barrier.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Reading again in place needs nothing.
+    recorder.access_image(image, COLOR_RANGE, image_state, FRAGMENT_READ);
+    REQUIRE(recorder.resolve() == nullptr);
+  }
+}
+
+}  // namespace volcano
@@ -145,7 +145,8 @@ class PlatformWindow final : public Window {
 
     ::VkSurfaceKHR surface = VK_NULL_HANDLE;
     ::VkResult result =
-        ::glfwCreateWindowSurface(instance, glfw_window_, nullptr, &surface);
+        ::glfwCreateWindowSurface(instance, glfw_window_, vk::ALLOCATOR,
+                                  &surface);
     CHECK_POSTCONDITION(result == VK_SUCCESS);
     CHECK_POSTCONDITION(surface != VK_NULL_HANDLE);
 
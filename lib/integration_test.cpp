@@ -1,21 +1,718 @@
+#include "hello.hpp"
 #include "lib/glfw_window.hpp"
 #include "lib/resource.hpp"
+#include "lib/thread_pool.hpp"
+#include "shaders/shaders.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lib/allocation_counter.hpp"
 #include "lib/testing.hpp"
 
 namespace volcano {
 
-TEST_CASE("Integration") {
+namespace {
+// Sets an environment variable for the rest of the scope, then restores it.
+class ScopedEnvironmentVariable final {
+ public:
+  DECLARE_COPY_DELETE(ScopedEnvironmentVariable);
+  DECLARE_MOVE_DELETE(ScopedEnvironmentVariable);
+
+  ScopedEnvironmentVariable(const char* name, const char* value)
+      : name_{name} {
+    if (const char* previous = std::getenv(name)) {
+      maybe_previous_value_ = previous;
+    }
+    ::setenv(name, value, 1);
+  }
+
+  ~ScopedEnvironmentVariable() {
+    if (maybe_previous_value_) {
+      ::setenv(name_.c_str(), maybe_previous_value_->c_str(), 1);
+    } else {
+      ::unsetenv(name_.c_str());
+    }
+  }
+
+ private:
+  std::string name_;
+  std::optional<std::string> maybe_previous_value_;
+};
+
+// A presentation device on a window of its own.
+struct TestDevice final {
+  DECLARE_COPY_DELETE(TestDevice);
+  DECLARE_MOVE_DELETE(TestDevice);
+
+  explicit TestDevice(DebugLevel debug_level = DebugLevel::VERBOSE)
+      : instance{application.create_instance(
+            {}, platform_window.required_extensions(), debug_level)},
+        device{instance.create_presentation_device(
+            platform_window.create_surface(instance))} {}
+
+  ~TestDevice() { device.wait_for_idle(); }
+
   Application application{"test-app", 0};
   glfw::PlatformWindow platform_window{"test-glfw-window",
                                        {.width = 800, .height = 600}};
+  Instance instance;
+  Device device;
+};
+
+// The triangle hello draws, uploaded to a device local vertex buffer.
+struct TriangleVertexBuffer final {
+  DECLARE_COPY_DELETE(TriangleVertexBuffer);
+  DECLARE_MOVE_DELETE(TriangleVertexBuffer);
+
+  explicit TriangleVertexBuffer(Device& device)
+      : buffer{device.create_buffer(sizeof(Vertex2D_ColorF_pack) *
+                                        vertex_count,
+                                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_TRANSFER_DST_BIT)},
+        memory{device.allocate_device_memory(buffer, MemoryUsage::GPU_ONLY)} {
+    auto vertices = triangle_vertices();
+    auto upload_service = device.create_upload_service();
+    upload_service.wait(
+        upload_service.upload(buffer, std::as_bytes(std::span{vertices})));
+  }
+
+  static constexpr std::uint32_t vertex_count = 3;
+
+  Buffer buffer;
+  DeviceMemory memory;
+};
+}  // namespace
 
-  auto instance = application.CreateInstance(
-      {}, platform_window.RequiredExtensions(), DebugLevel::VERBOSE);
-  auto surface = platform_window.CreateSurface(instance.Handle());
-  auto device = instance.FindDeviceForSurface(surface);
+TEST_CASE("Integration") {
+  TestDevice test_device;
 
   SECTION("ShouldPass") { REQUIRE(true); }
 }
 
+TEST_CASE("DeviceMemoryHeap") {
+  constexpr ::VkDeviceSize block_byte_count = 1 << 20;
+  constexpr ::VkDeviceSize granularity = 4096;
+
+  // One memory type without host access, with a granularity of our own.
+  TestDevice test_device;
+  ::VkPhysicalDeviceMemoryProperties memory_properties{
+      .memoryTypeCount = 1,
+      .memoryTypes = {{.propertyFlags = 0, .heapIndex = 0}},
+      .memoryHeapCount = 1,
+      .memoryHeaps = {{.size = 64 * block_byte_count}},
+  };
+  ::VkPhysicalDeviceLimits limits{
+      .maxMemoryAllocationCount = 4,
+      .bufferImageGranularity = granularity,
+      .nonCoherentAtomSize = 64,
+  };
+  DeviceMemoryAllocator allocator{
+      test_device.device.memory_allocator().device(), memory_properties,
+      limits, block_byte_count};
+  auto& heap = allocator.heap(0);
+
+  auto requirements = [](::VkDeviceSize byte_count,
+                         ::VkDeviceSize byte_alignment) {
+    return ::VkMemoryRequirements{
+        .size = byte_count,
+        .alignment = byte_alignment,
+        .memoryTypeBits = 0b1,
+    };
+  };
+
+  SECTION("ShouldSubAllocateFromOneBlock") {
+    // Under Test.
+    auto a = heap.allocate(requirements(1000, 16), MemoryTiling::LINEAR);
+    auto b = heap.allocate(requirements(1000, 16), MemoryTiling::LINEAR);
+
+    // Postcondition.
+    REQUIRE(a.block == b.block);
+    REQUIRE(a.byte_count == 1000);
+    REQUIRE(b.byte_offset >= a.byte_offset + a.byte_count);
+    REQUIRE(allocator.block_count() == 1);
+    heap.free(a);
+    heap.free(b);
+  }
+
+  SECTION("ShouldHonorAlignment") {
+    // Under Test.
+    auto a = heap.allocate(requirements(100, 1), MemoryTiling::LINEAR);
+    auto b = heap.allocate(requirements(100, 1024), MemoryTiling::LINEAR);
+
+    // Postcondition.
+    REQUIRE(b.byte_offset % 1024 == 0);
+    REQUIRE(b.byte_offset >= a.byte_offset + a.byte_count);
+    heap.free(a);
+    heap.free(b);
+  }
+
+  SECTION("ShouldPadOptimalToGranularity") {
+    // Under Test.
+    auto linear = heap.allocate(requirements(100, 1), MemoryTiling::LINEAR);
+    auto optimal = heap.allocate(requirements(100, 1), MemoryTiling::OPTIMAL);
+    auto next = heap.allocate(requirements(100, 1), MemoryTiling::LINEAR);
+
+    // Postcondition.
+    REQUIRE(optimal.byte_offset % granularity == 0);
+    REQUIRE(optimal.byte_offset >= linear.byte_offset + linear.byte_count);
+    REQUIRE(optimal.byte_count == granularity);
+    REQUIRE(next.byte_offset >= optimal.byte_offset + granularity);
+    heap.free(linear);
+    heap.free(optimal);
+    heap.free(next);
+  }
+
+  SECTION("ShouldReuseFreedRange") {
+    // Precondition.
+    auto a = heap.allocate(requirements(4096, 256), MemoryTiling::LINEAR);
+    heap.free(a);
+
+    // Under Test.
+    auto b = heap.allocate(requirements(4096, 256), MemoryTiling::LINEAR);
+
+    // Postcondition.
+    REQUIRE(b.block == a.block);
+    REQUIRE(b.byte_offset == a.byte_offset);
+    heap.free(b);
+  }
+
+  SECTION("ShouldReleaseDedicatedBlocks") {
+    // Precondition.
+    auto small = heap.allocate(requirements(100, 1), MemoryTiling::LINEAR);
+
+    // Under Test.
+    auto large =
+        heap.allocate(requirements(block_byte_count, 1), MemoryTiling::LINEAR);
+    REQUIRE(large.block != small.block);
+    REQUIRE(allocator.block_count() == 2);
+    heap.free(large);
+
+    // Postcondition.
+    REQUIRE(allocator.block_count() == 1);
+    heap.free(small);
+  }
+}
+
+TEST_CASE("UploadService") {
+  constexpr ::VkDeviceSize staging_byte_count = 256;
+  constexpr std::size_t target_byte_count = 1024;
+
+  TestDevice test_device;
+  auto& device = test_device.device;
+  auto upload_service = device.create_upload_service(staging_byte_count);
+  auto target = device.create_buffer(target_byte_count,
+                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  auto target_memory =
+      device.allocate_device_memory(target, MemoryUsage::READBACK);
+
+  std::vector<std::byte> data(target_byte_count);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<std::byte>(i * 7);
+  }
+  auto uploaded = [&] {
+    target_memory.invalidate();
+    auto host_bytes = target_memory.host_bytes().first(target_byte_count);
+    return std::equal(host_bytes.begin(), host_bytes.end(), data.begin());
+  };
+
+  SECTION("ShouldReuseTheStagingArena") {
+    // Under Test.
+    constexpr std::size_t chunk_byte_count = 96;
+    UploadToken token;
+    for (std::size_t offset = 0; offset < data.size();
+         offset += chunk_byte_count) {
+      auto chunk = std::span{data}.subspan(
+          offset, std::min(chunk_byte_count, data.size() - offset));
+      token = upload_service.upload(target, chunk, offset);
+    }
+    upload_service.wait(token);
+
+    // Postcondition.
+    REQUIRE(upload_service.staging_byte_count() == staging_byte_count);
+    REQUIRE(uploaded());
+  }
+
+  SECTION("ShouldGrowForUploadsLargerThanTheArena") {
+    // Under Test.
+    upload_service.wait(upload_service.upload(target, data));
+
+    // Postcondition.
+    REQUIRE(upload_service.staging_byte_count() >= target_byte_count);
+    REQUIRE(uploaded());
+  }
+}
+
+TEST_CASE("DynamicViewportAndScissor") {
+  constexpr ::VkExtent2D geometry{.width = 800, .height = 600};
+
+  TestDevice test_device;
+  auto& device = test_device.device;
+  auto vert_shader = device.create_shader_module(vertex_shader_spirv_bin);
+  auto frag_shader = device.create_shader_module(fragment_shader_spirv_bin);
+  TriangleVertexBuffer vertices{device};
+  std::array<::VkBuffer, 1> vertex_buffers{vertices.buffer};
+  std::array<::VkDeviceSize, 1> vertex_buffer_offsets{0};
+
+  auto swapchain = device.create_swapchain(geometry,                  //
+                                           VK_FORMAT_B8G8R8A8_UNORM,  //
+                                           VK_PRESENT_MODE_FIFO_KHR);
+  auto image_views = swapchain.create_image_views();
+  auto render_pass = device.create_render_pass(VK_FORMAT_B8G8R8A8_UNORM);
+  auto framebuffers = device.create_framebuffers(render_pass, image_views);
+
+  // Built without knowing the framebuffer's extent.
+  auto pipeline_layout = device.find_or_create_pipeline_layout();
+  auto graphics_pipeline = device.find_or_create_graphics_pipeline(
+      vert_shader, frag_shader, pipeline_layout, render_pass);
+
+  auto queue = device.create_queue();
+  auto command_pool = device.create_command_pool(queue.family_index());
+  auto command_buffers = device.allocate_command_buffer_block(command_pool, 1);
+  auto create_builder = [&] {
+    auto builder = command_buffers.create_render_pass_command_builder(
+        0, render_pass, framebuffers[0], framebuffers[0].extent());
+    builder.bind(graphics_pipeline);
+    return builder;
+  };
+
+  SECTION("ShouldDrawAfterSettingViewportAndScissor") {
+    // Under Test.
+    ::VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    {
+      auto builder = create_builder();
+      builder.set_viewport(framebuffers[0].extent());
+      builder.set_scissor(framebuffers[0].extent());
+      builder.bind(0, vertex_buffers, vertex_buffer_offsets);
+      builder.draw(TriangleVertexBuffer::vertex_count);
+      command_buffer = builder;
+    }
+    queue.submit(command_buffer, {}, {}, {}, {}, {});
+
+    // Postcondition.
+    REQUIRE_NOTHROW(device.wait_for_idle());
+  }
+
+  SECTION("ShouldRejectEmptyViewport") {
+    auto builder = create_builder();
+    REQUIRE_THROWS_AS(builder.set_viewport(::VkExtent2D{.width = 0}),
+                      std::logic_error);
+  }
+
+  SECTION("ShouldRejectNegativeScissorOffset") {
+    auto builder = create_builder();
+    REQUIRE_THROWS_AS(builder.set_scissor(::VkRect2D{
+                          .offset = {.x = -1, .y = 0},
+                          .extent = framebuffers[0].extent(),
+                      }),
+                      std::logic_error);
+  }
+}
+
+TEST_CASE("PipelineRegistry") {
+  TestDevice test_device;
+  auto& device = test_device.device;
+  auto vert_shader = device.create_shader_module(vertex_shader_spirv_bin);
+  auto frag_shader = device.create_shader_module(fragment_shader_spirv_bin);
+  auto render_pass = device.create_render_pass(VK_FORMAT_B8G8R8A8_UNORM);
+  auto pipeline_layout = device.find_or_create_pipeline_layout();
+
+  SECTION("ShouldHitOnSecondLookupOfEqualKey") {
+    // Under Test.
+    auto first = device.find_or_create_graphics_pipeline(
+        vert_shader, frag_shader, pipeline_layout, render_pass);
+    auto second = device.find_or_create_graphics_pipeline(
+        vert_shader, frag_shader, pipeline_layout, render_pass);
+
+    // Postcondition.
+    REQUIRE(first == second);
+    REQUIRE(device.pipeline_registry().miss_count() == 1);
+    REQUIRE(device.pipeline_registry().hit_count() == 1);
+    REQUIRE(device.pipeline_registry().graphics_pipeline_count() == 1);
+  }
+}
+
+TEST_CASE("ParallelCommandRecorder") {
+  constexpr ::VkExtent2D geometry{.width = 800, .height = 600};
+  constexpr std::uint32_t chunk_count = 8;
+
+  TestDevice test_device;
+  auto& device = test_device.device;
+  auto vert_shader = device.create_shader_module(vertex_shader_spirv_bin);
+  auto frag_shader = device.create_shader_module(fragment_shader_spirv_bin);
+  TriangleVertexBuffer vertices{device};
+  std::array<::VkBuffer, 1> vertex_buffers{vertices.buffer};
+  std::array<::VkDeviceSize, 1> vertex_buffer_offsets{0};
+
+  auto swapchain = device.create_swapchain(geometry,                  //
+                                           VK_FORMAT_B8G8R8A8_UNORM,  //
+                                           VK_PRESENT_MODE_FIFO_KHR);
+  auto image_views = swapchain.create_image_views();
+  auto render_pass = device.create_render_pass(VK_FORMAT_B8G8R8A8_UNORM);
+  auto framebuffers = device.create_framebuffers(render_pass, image_views);
+  auto pipeline_layout = device.find_or_create_pipeline_layout();
+  auto graphics_pipeline = device.find_or_create_graphics_pipeline(
+      vert_shader, frag_shader, pipeline_layout, render_pass);
+
+  auto queue = device.create_queue();
+  auto command_pool = device.create_command_pool(queue.family_index());
+  auto command_buffers = device.allocate_command_buffer_block(command_pool, 1);
+  ThreadPool thread_pool{3};
+  auto recorder = device.create_parallel_command_recorder(
+      thread_pool, queue.family_index());
+
+  auto record = [&] {
+    return recorder.record(
+        render_pass, 0, framebuffers[0], chunk_count,
+        [&](std::uint32_t, SecondaryCommandBuilder& builder) {
+          builder.bind(graphics_pipeline);
+          builder.set_viewport(framebuffers[0].extent());
+          builder.set_scissor(framebuffers[0].extent());
+          builder.bind(0, vertex_buffers, vertex_buffer_offsets);
+          builder.draw(TriangleVertexBuffer::vertex_count);
+        });
+  };
+  auto execute = [&](std::span<const ::VkCommandBuffer> secondaries) {
+    ::VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    {
+      auto builder = command_buffers.create_render_pass_execute_command_builder(
+          0, render_pass, framebuffers[0], framebuffers[0].extent());
+      builder.execute(secondaries);
+      command_buffer = builder;
+    }
+    queue.submit(command_buffer, {}, {}, {}, {}, {});
+    device.wait_for_idle();
+  };
+
+  SECTION("ShouldRecordEveryChunk") {
+    // Under Test.
+    std::vector<::VkCommandBuffer> recorded;
+    std::ranges::copy(record(), std::back_inserter(recorded));
+    execute(recorded);
+
+    // Postcondition.
+    REQUIRE(recorded.size() == chunk_count);
+    REQUIRE(std::ranges::find(recorded, VK_NULL_HANDLE) == recorded.end());
+    std::ranges::sort(recorded);
+    REQUIRE(std::ranges::adjacent_find(recorded) == recorded.end());
+  }
+
+  SECTION("ShouldRecordAgainAfterReset") {
+    // Precondition.
+    execute(record());
+    command_pool.reset();
+
+    // Under Test.
+    recorder.reset();
+    auto recorded = record();
+    execute(recorded);
+
+    // Postcondition.
+    REQUIRE(recorded.size() == chunk_count);
+  }
+
+  SECTION("ShouldRethrowFromChunk") {
+    // Under Test.
+    REQUIRE_THROWS_AS(
+        recorder.record(render_pass, 0, framebuffers[0], chunk_count,
+                        [](std::uint32_t chunk, SecondaryCommandBuilder&) {
+                          if (chunk == 3) {
+                            throw std::logic_error{"chunk failed"};
+                          }
+                        }),
+        std::logic_error);
+
+    // Postcondition.
+    recorder.reset();
+    execute(record());
+  }
+}
+
+TEST_CASE("CullingPass") {
+  TestDevice test_device;
+  auto& device = test_device.device;
+  if (!device.supports_draw_indirect_count()) {
+    SKIP("Needs drawIndirectCount");
+  }
+
+  // The identity keeps x and y in [-1, 1] and z in [0, 1].
+  auto planes = frustum_planes({1.f, 0.f, 0.f, 0.f,  //
+                                0.f, 1.f, 0.f, 0.f,  //
+                                0.f, 0.f, 1.f, 0.f,  //
+                                0.f, 0.f, 0.f, 1.f});
+  const std::array<std::array<float, 4>, 6> spheres{{
+      {0.f, 0.f, 0.5f, 0.1f},     // Inside.
+      {5.f, 0.f, 0.5f, 1.f},      // Right of the frustum.
+      {1.05f, 0.f, 0.5f, 0.1f},   // Straddling the right plane.
+      {0.f, 0.f, -2.f, 0.5f},     // Behind the near plane.
+      {0.f, -0.5f, 0.9f, 0.05f},  // Inside.
+      {0.f, 0.f, 1.5f, 0.6f},     // Straddling the far plane.
+  }};
+  std::array<CullingInstance, spheres.size()> instances;
+  for (std::uint32_t i = 0; i < instances.size(); ++i) {
+    instances[i] = CullingInstance{
+        .bounding_sphere = spheres[i],
+        .index_count = 3 * (i + 1),
+        .first_index = 10 * i,
+        .vertex_offset = -narrow_cast<std::int32_t>(i),
+    };
+  }
+
+  auto instance_buffer = device.create_buffer(
+      sizeof(instances), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  auto instance_memory =
+      device.allocate_device_memory(instance_buffer, MemoryUsage::DYNAMIC);
+  instance_memory.copy_initialize(std::as_bytes(std::span{instances}));
+  auto culling_pass = device.create_culling_pass(instance_buffer);
+
+  auto draw_commands_readback = device.create_buffer(
+      culling_pass.draw_commands().byte_count(),
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  auto draw_commands_readback_memory = device.allocate_device_memory(
+      draw_commands_readback, MemoryUsage::READBACK);
+  auto draw_count_readback = device.create_buffer(
+      sizeof(std::uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  auto draw_count_readback_memory = device.allocate_device_memory(
+      draw_count_readback, MemoryUsage::READBACK);
+
+  auto queue = device.create_queue();
+  auto command_pool = device.create_command_pool(queue.family_index());
+  auto command_buffers = device.allocate_command_buffer_block(command_pool, 1);
+
+  SECTION("ShouldMatchTheHostTest") {
+    // Under Test.
+    {
+      auto builder = command_buffers.create_compute_command_builder(0);
+      culling_pass.record(builder, planes, instances.size());
+      builder.barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_TRANSFER_READ_BIT);
+      builder.copy(culling_pass.draw_commands(), draw_commands_readback,
+                   draw_commands_readback.byte_count());
+      builder.copy(culling_pass.draw_count(), draw_count_readback,
+                   sizeof(std::uint32_t));
+      builder.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    }
+    queue.submit(command_buffers[0], {}, {}, {}, {}, {});
+    device.wait_for_idle();
+
+    // Postcondition.
+    draw_count_readback_memory.invalidate();
+    draw_commands_readback_memory.invalidate();
+    std::uint32_t draw_count = 0;
+    std::memcpy(&draw_count, draw_count_readback_memory.host_bytes().data(),
+                sizeof(draw_count));
+    std::vector<::VkDrawIndexedIndirectCommand> draws(draw_count);
+    std::memcpy(draws.data(), draw_commands_readback_memory.host_bytes().data(),
+                draw_count * sizeof(::VkDrawIndexedIndirectCommand));
+
+    // Survivors are appended in whatever order invocations finish.
+    std::sort(draws.begin(), draws.end(),
+              [](const ::VkDrawIndexedIndirectCommand& a,
+                 const ::VkDrawIndexedIndirectCommand& b) {
+                return a.firstInstance < b.firstInstance;
+              });
+    std::vector<std::uint32_t> visible;
+    for (std::uint32_t i = 0; i < instances.size(); ++i) {
+      if (is_sphere_in_frustum(planes, spheres[i])) {
+        visible.push_back(i);
+      }
+    }
+    REQUIRE(visible == std::vector<std::uint32_t>{0, 2, 4, 5});
+    REQUIRE(draws.size() == visible.size());
+    for (std::size_t i = 0; i < draws.size(); ++i) {
+      auto&& instance = instances[visible[i]];
+      REQUIRE(draws[i].firstInstance == visible[i]);
+      REQUIRE(draws[i].instanceCount == 1);
+      REQUIRE(draws[i].indexCount == instance.index_count);
+      REQUIRE(draws[i].firstIndex == instance.first_index);
+      REQUIRE(draws[i].vertexOffset == instance.vertex_offset);
+    }
+  }
+}
+
+TEST_CASE("FramePacer") {
+  constexpr std::uint32_t frame_count = 3;
+
+  TestDevice test_device;
+  auto& device = test_device.device;
+  auto frame_pacer = device.create_frame_pacer(frame_count);
+  auto queue = device.create_queue();
+  auto command_pool = device.create_command_pool(queue.family_index());
+  auto command_buffers =
+      device.allocate_command_buffer_block(command_pool, frame_count);
+  for (std::uint32_t i = 0; i < frame_count; ++i) {
+    command_buffers.create_compute_command_builder(i);
+  }
+
+  // Signals the current frame's value once the GPU gets to it.
+  auto submit_frame = [&](std::uint32_t frame_index) {
+    std::array<::VkSemaphore, 1> signal_semaphores{frame_pacer.timeline()};
+    std::array<std::uint64_t, 1> signal_values{frame_pacer.frame_value()};
+    queue.submit(command_buffers[frame_index], {}, {}, {}, signal_semaphores,
+                 signal_values);
+    frame_pacer.end_frame();
+  };
+
+  SECTION("ShouldWrapAroundTheFrameSlots") {
+    // Under Test.
+    std::vector<std::uint32_t> frame_indices;
+    for (std::uint32_t i = 0; i < 3 * frame_count; ++i) {
+      frame_indices.push_back(frame_pacer.begin_frame());
+      REQUIRE(frame_pacer.frame_value() == i + 1);
+      REQUIRE(frame_pacer.completed_value() + frame_count >=
+              frame_pacer.frame_value());
+      submit_frame(frame_indices.back());
+    }
+
+    // Postcondition.
+    REQUIRE(frame_indices ==
+            std::vector<std::uint32_t>{0, 1, 2, 0, 1, 2, 0, 1, 2});
+    REQUIRE(frame_pacer.timeline().wait(3 * frame_count));
+  }
+
+  SECTION("ShouldBeginAFailedFrameAgain") {
+    // Precondition.
+    for (std::uint32_t i = 0; i < frame_count; ++i) {
+      submit_frame(frame_pacer.begin_frame());
+    }
+
+    // Under Test.
+    std::uint32_t failed_frame_index = frame_pacer.begin_frame();
+    std::uint64_t failed_frame_value = frame_pacer.frame_value();
+    std::uint32_t frame_index = frame_pacer.begin_frame();
+
+    // Postcondition.
+    REQUIRE(frame_index == failed_frame_index);
+    REQUIRE(frame_pacer.frame_value() == failed_frame_value);
+    submit_frame(frame_index);
+    for (std::uint32_t i = 0; i < frame_count; ++i) {
+      submit_frame(frame_pacer.begin_frame());
+    }
+    REQUIRE(frame_pacer.timeline().wait(frame_pacer.frame_value(),
+                                        std::chrono::seconds{5}));
+  }
+
+  device.wait_for_idle();
+}
+
+TEST_CASE("SubmissionWorker") {
+  constexpr std::uint32_t submission_count = 16;
+
+  TestDevice test_device;
+  auto& device = test_device.device;
+  auto command_pool = device.create_command_pool(
+      device.queue_family_index(QueueKind::GRAPHICS));
+  auto command_buffers =
+      device.allocate_command_buffer_block(command_pool, submission_count);
+  for (std::uint32_t i = 0; i < submission_count; ++i) {
+    command_buffers.create_compute_command_builder(i);
+  }
+
+  SECTION("ShouldCompleteInSubmitOrder") {
+    // Precondition.
+    auto worker = device.create_submission_worker();
+
+    // Under Test.
+    std::vector<SubmissionToken> tokens;
+    for (std::uint32_t i = 0; i < submission_count; ++i) {
+      tokens.push_back(worker.submit({.command_buffer = command_buffers[i]}));
+    }
+    REQUIRE(worker.wait(tokens.back()));
+
+    // Postcondition.
+    for (std::uint32_t i = 1; i < submission_count; ++i) {
+      REQUIRE(tokens[i - 1].serial < tokens[i].serial);
+      REQUIRE(worker.is_complete(tokens[i - 1]));
+    }
+    REQUIRE(worker.take_present_result() == VK_SUCCESS);
+  }
+
+  SECTION("ShouldFinishSubmittedWorkOnDestruction") {
+    // Precondition.
+    auto fences = device.create_fences(1);
+    auto& last_fence = fences[0];
+    REQUIRE_FALSE(last_fence.is_signaled());
+
+    // Under Test.
+    {
+      auto worker = device.create_submission_worker();
+      for (std::uint32_t i = 0; i + 1 < submission_count; ++i) {
+        worker.submit({.command_buffer = command_buffers[i]});
+      }
+      worker.submit({
+          .command_buffer = command_buffers[submission_count - 1],
+          .maybe_signal_fence = last_fence,
+      });
+    }
+
+    // Postcondition.
+    REQUIRE(last_fence.is_signaled());
+    command_pool.reset();  // Only valid once none of its buffers are pending.
+  }
+}
+
+TEST_CASE("SteadyStateFrame") {
+  constexpr ::VkExtent2D geometry{.width = 800, .height = 600};
+
+  // Layers allocate on our threads; only measure our own frame loop.
+  ScopedEnvironmentVariable disable_layers{"VK_LOADER_LAYERS_DISABLE",
+                                           "~all~"};
+
+  TestDevice test_device{DebugLevel::NONE};
+  auto& device = test_device.device;
+  auto vert_shader = device.create_shader_module(vertex_shader_spirv_bin);
+  auto frag_shader = device.create_shader_module(fragment_shader_spirv_bin);
+  TriangleVertexBuffer vertices{device};
+
+  auto queue = device.create_queue();
+  auto frame_pacer = device.create_frame_pacer(max_frame_count);
+  RetireQueue retire_queue;
+  SwapchainRenderContext context{geometry,                            //
+                                 vertices.buffer,                     //
+                                 TriangleVertexBuffer::vertex_count,  //
+                                 vert_shader,                         //
+                                 frag_shader,                         //
+                                 VK_NULL_HANDLE,                      //
+                                 InOut(device),                       //
+                                 queue.family_index()};
+
+  auto renderer = device.create_surface_renderer(
+      [](::VkExtent2D) -> bool { return true; },
+      [&]() { render_frame(context, queue, frame_pacer, retire_queue); });
+  renderer->RecreateSwapchain(geometry);
+  REQUIRE(renderer->HasSwapchain());
+
+  SECTION("ShouldNotAllocate") {
+    // Precondition.
+    for (std::uint32_t i = 0; i < 2 * context.framebuffers.size(); ++i) {
+      renderer->Render();
+    }
+
+    // Under Test.
+    ScopedAllocationCount allocations;
+    for (int i = 0; i < 100; ++i) {
+      renderer->Render();
+    }
+
+    // Postcondition.
+    REQUIRE(allocations.count() == 0);
+  }
+
+  device.wait_for_idle();
+}
+
 }  // namespace volcano
@@ -0,0 +1,607 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "lib/base.hpp"
+#include "vk/resource.hpp"
+
+namespace volcano {
+namespace impl {
+constexpr ::VkDeviceSize DEFAULT_MEMORY_BLOCK_BYTE_COUNT = 64ull << 20;  // MiB
+
+// The block size is clamped to a fraction of small heaps (eg. 256MiB BAR).
+constexpr ::VkDeviceSize MEMORY_HEAP_BLOCK_FRACTION = 8;
+
+constexpr ::VkDeviceSize align_up(::VkDeviceSize value,
+                                  ::VkDeviceSize alignment) {
+  return alignment > 1 ? ((value + alignment - 1) / alignment) * alignment
+                       : value;
+}
+
+constexpr ::VkDeviceSize align_down(::VkDeviceSize value,
+                                    ::VkDeviceSize alignment) {
+  return alignment > 1 ? (value / alignment) * alignment : value;
+}
+}  // namespace impl
+
+struct ByteRange final {
+  ::VkDeviceSize byte_offset = 0;
+  ::VkDeviceSize byte_count = 0;
+
+  bool operator==(const ByteRange&) const = default;
+};
+
+// Expands a range outwards to `nonCoherentAtomSize` boundaries, as required by
+// `vkFlushMappedMemoryRanges` and `vkInvalidateMappedMemoryRanges`, without
+// crossing `byte_limit`.
+constexpr ByteRange expand_to_atom_boundaries(ByteRange range,
+                                              ::VkDeviceSize atom_byte_count,
+                                              ::VkDeviceSize byte_limit) {
+  ::VkDeviceSize begin = impl::align_down(range.byte_offset, atom_byte_count);
+  ::VkDeviceSize end = std::min(
+      impl::align_up(range.byte_offset + range.byte_count, atom_byte_count),
+      byte_limit);
+  return {begin, end - begin};
+}
+
+// Resources with optimal tiling may not share a `bufferImageGranularity` page
+// with linear resources.
+enum class MemoryTiling {
+  LINEAR,
+  OPTIMAL,
+};
+
+//------------------------------------------------------------------------------
+// Allocation intent; each maps to an ordered list of memory type preferences.
+enum class MemoryUsage {
+  GPU_ONLY,  // Device reads and writes; no host access.
+  UPLOAD,    // Host writes once (eg. staging), device reads.
+  READBACK,  // Device writes, host reads.
+  DYNAMIC,   // Host rewrites often (eg. per frame), device reads.
+};
+
+struct MemoryTypePreference final {
+  ::VkMemoryPropertyFlags required = 0;
+  ::VkMemoryPropertyFlags preferred = 0;
+  ::VkMemoryPropertyFlags avoided = 0;
+};
+
+namespace impl {
+// Never picked unless explicitly required.
+constexpr ::VkMemoryPropertyFlags EXOTIC_MEMORY_FLAGS =
+    VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT |
+    VK_MEMORY_PROPERTY_PROTECTED_BIT |
+    VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD |
+    VK_MEMORY_PROPERTY_DEVICE_UNCACHED_BIT_AMD;
+
+constexpr std::array<MemoryTypePreference, 2> GPU_ONLY_PREFERENCES{
+    // Keep host visible (eg. BAR) memory free for those who need it.
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+    },
+    MemoryTypePreference{
+        .preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    },
+};
+
+// Host visible memory need not be coherent; see `DeviceMemory::flush()` and
+// `DeviceMemory::invalidate()`.
+constexpr std::array<MemoryTypePreference, 2> UPLOAD_PREFERENCES{
+    // Write-combined system memory; don't waste device local memory.
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        .preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                   VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+    },
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        .preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    },
+};
+
+constexpr std::array<MemoryTypePreference, 2> READBACK_PREFERENCES{
+    // Uncached reads are extremely slow.
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        .preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        .avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    },
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        .preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+    },
+};
+
+constexpr std::array<MemoryTypePreference, 2> DYNAMIC_PREFERENCES{
+    // Device local and host visible (eg. ReBAR/UMA) avoids a copy.
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        .preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+    },
+    MemoryTypePreference{
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        .preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    },
+};
+}  // namespace impl
+
+inline std::span<const MemoryTypePreference> memory_type_preferences(
+    MemoryUsage usage) {
+  switch (usage) {
+    case MemoryUsage::GPU_ONLY:
+      return impl::GPU_ONLY_PREFERENCES;
+    case MemoryUsage::UPLOAD:
+      return impl::UPLOAD_PREFERENCES;
+    case MemoryUsage::READBACK:
+      return impl::READBACK_PREFERENCES;
+    case MemoryUsage::DYNAMIC:
+      return impl::DYNAMIC_PREFERENCES;
+  }
+  CHECK_UNREACHABLE();
+  return {};
+}
+
+// Ranks the memory types allowed by `memory_type_bits` that have all required
+// flags: each preferred flag present scores +1, each avoided flag present -1.
+// Ties go to the larger heap, then to the lower index.
+inline std::optional<std::uint32_t> select_memory_type(
+    const ::VkPhysicalDeviceMemoryProperties& memory_properties,
+    std::uint32_t memory_type_bits, const MemoryTypePreference& preference) {
+  std::optional<std::uint32_t> selected;
+  int selected_score = 0;
+  ::VkDeviceSize selected_heap_byte_count = 0;
+
+  for (std::uint32_t memory_type_index = 0;
+       memory_type_index < memory_properties.memoryTypeCount;
+       ++memory_type_index) {
+    auto&& memory_type = memory_properties.memoryTypes[memory_type_index];
+    ::VkMemoryPropertyFlags flags = memory_type.propertyFlags;
+
+    if (!(memory_type_bits & (1u << memory_type_index)) ||
+        !vk::has_all_flags(flags, preference.required) ||
+        vk::has_any_flags(flags,
+                          impl::EXOTIC_MEMORY_FLAGS & ~preference.required)) {
+      continue;
+    }
+
+    int score = std::popcount(flags & preference.preferred) -
+                std::popcount(flags & preference.avoided);
+    ::VkDeviceSize heap_byte_count =
+        memory_properties.memoryHeaps[memory_type.heapIndex].size;
+
+    if (!selected || score > selected_score ||
+        (score == selected_score &&
+         heap_byte_count > selected_heap_byte_count)) {
+      selected = memory_type_index;
+      selected_score = score;
+      selected_heap_byte_count = heap_byte_count;
+    }
+  }
+
+  return selected;
+}
+
+// Tries each preference for `usage` in turn.
+inline std::optional<std::uint32_t> select_memory_type(
+    const ::VkPhysicalDeviceMemoryProperties& memory_properties,
+    std::uint32_t memory_type_bits, MemoryUsage usage) {
+  for (auto&& preference : memory_type_preferences(usage)) {
+    if (auto selected = select_memory_type(memory_properties, memory_type_bits,
+                                           preference)) {
+      return selected;
+    }
+  }
+  return std::nullopt;
+}
+
+//------------------------------------------------------------------------------
+// First-fit free list over the byte range [0, capacity). Free ranges are kept
+// sorted by offset and coalesced with their neighbours on release.
+class FreeList final {
+ public:
+  DECLARE_COPY_DELETE(FreeList);
+  DECLARE_MOVE_DEFAULT(FreeList);
+
+  FreeList() = delete;
+  ~FreeList() = default;
+
+  explicit FreeList(::VkDeviceSize byte_count)
+      : capacity_{byte_count}, available_{byte_count} {
+    if (byte_count) {
+      free_ranges_[0] = byte_count;
+    }
+  }
+
+  ::VkDeviceSize capacity() const { return capacity_; }
+  ::VkDeviceSize available() const { return available_; }
+  std::size_t fragment_count() const { return free_ranges_.size(); }
+  bool empty() const { return available_ == capacity_; }
+
+  std::optional<::VkDeviceSize> allocate(::VkDeviceSize byte_count,
+                                         ::VkDeviceSize byte_alignment) {
+    CHECK_PRECONDITION(byte_count > 0);
+    CHECK_PRECONDITION(byte_alignment > 0);
+
+    for (auto iter = free_ranges_.begin(); iter != free_ranges_.end();
+         ++iter) {
+      auto [range_offset, range_count] = *iter;
+      ::VkDeviceSize byte_offset = impl::align_up(range_offset, byte_alignment);
+      ::VkDeviceSize padding = byte_offset - range_offset;
+      if (padding + byte_count > range_count) {
+        continue;
+      }
+
+      free_ranges_.erase(iter);
+      if (padding) {
+        free_ranges_[range_offset] = padding;
+      }
+      if (::VkDeviceSize tail = range_count - padding - byte_count) {
+        free_ranges_[byte_offset + byte_count] = tail;
+      }
+
+      available_ -= byte_count;
+      return byte_offset;
+    }
+
+    return std::nullopt;
+  }
+
+  void free(::VkDeviceSize byte_offset, ::VkDeviceSize byte_count) {
+    CHECK_PRECONDITION(byte_count > 0);
+    CHECK_PRECONDITION(byte_offset + byte_count <= capacity_);
+
+    auto next = free_ranges_.lower_bound(byte_offset);
+    CHECK_PRECONDITION(next == free_ranges_.end() ||
+                       byte_offset + byte_count <= next->first);
+
+    if (next != free_ranges_.begin()) {
+      auto prev = std::prev(next);
+      CHECK_PRECONDITION(prev->first + prev->second <= byte_offset);
+
+      if (prev->first + prev->second == byte_offset) {
+        byte_offset = prev->first;
+        byte_count += prev->second;
+        available_ -= prev->second;
+        free_ranges_.erase(prev);
+      }
+    }
+
+    if (next != free_ranges_.end() && byte_offset + byte_count == next->first) {
+      byte_count += next->second;
+      available_ -= next->second;
+      free_ranges_.erase(next);
+    }
+
+    free_ranges_[byte_offset] = byte_count;
+    available_ += byte_count;
+    CHECK_POSTCONDITION(available_ <= capacity_);
+  }
+
+ private:
+  std::map<::VkDeviceSize, ::VkDeviceSize> free_ranges_;  // Offset -> count.
+  ::VkDeviceSize capacity_ = 0;
+  ::VkDeviceSize available_ = 0;
+};
+
+//------------------------------------------------------------------------------
+// One `vkAllocateMemory` call, split into sub-allocations. Host visible blocks
+// are mapped once for their whole lifetime.
+class DeviceMemoryBlock final {
+ public:
+  DECLARE_COPY_DELETE(DeviceMemoryBlock);
+  DECLARE_MOVE_DELETE(DeviceMemoryBlock);
+
+  DeviceMemoryBlock() = delete;
+  ~DeviceMemoryBlock() = default;
+
+  explicit DeviceMemoryBlock(::VkDevice device,                //
+                             ::VkDeviceSize byte_count,        //
+                             std::uint32_t memory_type_index,  //
+                             ::VkMemoryPropertyFlags memory_flags)
+      : free_list_{byte_count} {
+    memory_ = vk::DeviceMemory{device, ::VkMemoryAllocateInfo{
+                                           .allocationSize = byte_count,
+                                           .memoryTypeIndex = memory_type_index,
+                                       }};
+
+    if (vk::has_all_flags(memory_flags, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+      void* host_pointer = nullptr;
+      ::VkMemoryMapFlags flags = 0;
+      ::VkResult result = ::vkMapMemory(device, memory_, 0, VK_WHOLE_SIZE,
+                                        flags, std::addressof(host_pointer));
+      CHECK_POSTCONDITION(result == VK_SUCCESS);
+
+      host_bytes_ = reinterpret_cast<std::byte*>(host_pointer);
+    }
+  }
+
+  operator ::VkDeviceMemory() const { return memory_.handle(); }
+  ::VkDevice device() const { return memory_.parent(); }
+
+  // Null unless the memory type is host visible.
+  std::byte* host_bytes() const { return host_bytes_; }
+
+  FreeList& free_list() { return free_list_; }
+  const FreeList& free_list() const { return free_list_; }
+
+ private:
+  vk::DeviceMemory memory_;
+  FreeList free_list_;
+  std::byte* host_bytes_ = nullptr;
+};
+
+//------------------------------------------------------------------------------
+// Bump-pointer allocator over `frame_count` equal regions. A region is reset
+// when its frame begins again, ie. after that frame's fence has signalled.
+class FrameRing final {
+ public:
+  DECLARE_COPY_DELETE(FrameRing);
+  DECLARE_MOVE_DEFAULT(FrameRing);
+
+  FrameRing() = delete;
+  ~FrameRing() = default;
+
+  explicit FrameRing(std::uint32_t frame_count,
+                     ::VkDeviceSize frame_byte_count)
+      : frame_count_{frame_count}, frame_byte_count_{frame_byte_count} {
+    CHECK_PRECONDITION(frame_count_ > 0);
+    CHECK_PRECONDITION(frame_byte_count_ > 0);
+  }
+
+  std::uint32_t frame_count() const { return frame_count_; }
+  ::VkDeviceSize frame_byte_count() const { return frame_byte_count_; }
+  ::VkDeviceSize byte_count() const { return frame_count_ * frame_byte_count_; }
+
+  std::uint32_t frame_index() const { return frame_index_; }
+  ::VkDeviceSize frame_byte_offset() const {
+    return frame_index_ * frame_byte_count_;
+  }
+  ::VkDeviceSize used_byte_count() const { return head_ - frame_byte_offset(); }
+
+  void begin_frame(std::uint32_t frame_index) {
+    CHECK_PRECONDITION(frame_index < frame_count_);
+    frame_index_ = frame_index;
+    head_ = frame_byte_offset();
+  }
+
+  std::optional<::VkDeviceSize> allocate(::VkDeviceSize byte_count,
+                                         ::VkDeviceSize byte_alignment) {
+    CHECK_PRECONDITION(byte_count > 0);
+    ::VkDeviceSize byte_offset = impl::align_up(head_, byte_alignment);
+    if (byte_offset + byte_count > frame_byte_offset() + frame_byte_count_) {
+      return std::nullopt;
+    }
+    head_ = byte_offset + byte_count;
+    return byte_offset;
+  }
+
+ private:
+  std::uint32_t frame_count_ = 0;
+  ::VkDeviceSize frame_byte_count_ = 0;
+  std::uint32_t frame_index_ = 0;
+  ::VkDeviceSize head_ = 0;
+};
+
+//------------------------------------------------------------------------------
+
+struct DeviceMemoryRange final {
+  DeviceMemoryBlock* block = nullptr;
+  ::VkDeviceSize byte_offset = 0;
+  ::VkDeviceSize byte_count = 0;
+};
+
+class DeviceMemoryAllocator;
+
+//------------------------------------------------------------------------------
+// Blocks of a single memory type. Requests larger than half a block get a
+// dedicated block sized to fit. Empty blocks are released, save the last one.
+class DeviceMemoryHeap final {
+ public:
+  DECLARE_COPY_DELETE(DeviceMemoryHeap);
+  DECLARE_MOVE_DELETE(DeviceMemoryHeap);
+
+  DeviceMemoryHeap() = delete;
+  ~DeviceMemoryHeap() = default;
+
+  explicit DeviceMemoryHeap(Depend<DeviceMemoryAllocator> allocator,  //
+                            std::uint32_t memory_type_index,          //
+                            ::VkMemoryPropertyFlags memory_flags,     //
+                            ::VkDeviceSize block_byte_count,          //
+                            ::VkDeviceSize non_coherent_atom_byte_count)
+      : allocator_{allocator},
+        memory_type_index_{memory_type_index},
+        memory_flags_{memory_flags},
+        block_byte_count_{block_byte_count} {
+    if (is_host_visible() && !is_host_coherent()) {
+      atom_byte_count_ =
+          std::max<::VkDeviceSize>(non_coherent_atom_byte_count, 1);
+    }
+  }
+
+  std::uint32_t memory_type_index() const { return memory_type_index_; }
+  ::VkMemoryPropertyFlags memory_flags() const { return memory_flags_; }
+
+  bool is_host_visible() const {
+    return vk::has_all_flags(memory_flags_,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+  }
+  bool is_host_coherent() const {
+    return vk::has_all_flags(memory_flags_,
+                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  }
+
+  // Granularity of host flushes and invalidations; sub-allocations are aligned
+  // to it so that they never touch their neighbours' atoms.
+  ::VkDeviceSize atom_byte_count() const { return atom_byte_count_; }
+  std::size_t block_count() const { return blocks_.size(); }
+
+  DeviceMemoryRange allocate(const ::VkMemoryRequirements& requirements,
+                             MemoryTiling tiling);
+  void free(const DeviceMemoryRange& range);
+
+  // As above, for destructors: freeing a range this heap didn't hand out
+  // asserts rather than throws.
+  void release(const DeviceMemoryRange& range) noexcept;
+
+ private:
+  Depend<DeviceMemoryAllocator> allocator_;
+  std::uint32_t memory_type_index_ = 0;
+  ::VkMemoryPropertyFlags memory_flags_ = 0;
+  ::VkDeviceSize block_byte_count_ = 0;
+  ::VkDeviceSize atom_byte_count_ = 1;
+  std::vector<std::unique_ptr<DeviceMemoryBlock>> blocks_;
+};
+
+//------------------------------------------------------------------------------
+// Per-device set of heaps, one per memory type. Tracks the live block count
+// against `maxMemoryAllocationCount`.
+class DeviceMemoryAllocator final {
+ public:
+  DECLARE_COPY_DELETE(DeviceMemoryAllocator);
+  DECLARE_MOVE_DELETE(DeviceMemoryAllocator);
+
+  DeviceMemoryAllocator() = delete;
+  ~DeviceMemoryAllocator() = default;
+
+  explicit DeviceMemoryAllocator(
+      ::VkDevice device,                                            //
+      const ::VkPhysicalDeviceMemoryProperties& memory_properties,  //
+      const ::VkPhysicalDeviceLimits& limits,                       //
+      ::VkDeviceSize block_byte_count = impl::DEFAULT_MEMORY_BLOCK_BYTE_COUNT)
+      : device_{device},
+        buffer_image_granularity_{limits.bufferImageGranularity},
+        max_block_count_{limits.maxMemoryAllocationCount} {
+    CHECK_PRECONDITION(device_ != VK_NULL_HANDLE);
+
+    for (std::uint32_t memory_type_index = 0;
+         memory_type_index < memory_properties.memoryTypeCount;
+         ++memory_type_index) {
+      auto&& memory_type = memory_properties.memoryTypes[memory_type_index];
+      auto&& memory_heap = memory_properties.memoryHeaps[memory_type.heapIndex];
+
+      heaps_.push_back(std::make_unique<DeviceMemoryHeap>(
+          Depend(*this),               //
+          memory_type_index,           //
+          memory_type.propertyFlags,   //
+          std::min(block_byte_count,   //
+                   memory_heap.size /  //
+                       impl::MEMORY_HEAP_BLOCK_FRACTION),
+          limits.nonCoherentAtomSize));
+    }
+  }
+
+  ::VkDevice device() const { return device_; }
+  ::VkDeviceSize buffer_image_granularity() const {
+    return buffer_image_granularity_;
+  }
+  std::uint32_t block_count() const { return block_count_; }
+
+  DeviceMemoryHeap& heap(std::uint32_t memory_type_index) {
+    CHECK_PRECONDITION(memory_type_index < heaps_.size());
+    return *heaps_[memory_type_index];
+  }
+
+ private:
+  friend class DeviceMemoryHeap;
+
+  std::unique_ptr<DeviceMemoryBlock> allocate_block(
+      ::VkDeviceSize byte_count,        //
+      std::uint32_t memory_type_index,  //
+      ::VkMemoryPropertyFlags memory_flags) {
+    CHECK_PRECONDITION(block_count_ < max_block_count_);
+    auto block = std::make_unique<DeviceMemoryBlock>(
+        device_, byte_count, memory_type_index, memory_flags);
+    block_count_++;
+    return block;
+  }
+
+  void free_block(std::unique_ptr<DeviceMemoryBlock> block) {
+    CHECK_PRECONDITION(block_count_ > 0);
+    block.reset();
+    block_count_--;
+  }
+
+  ::VkDevice device_ = VK_NULL_HANDLE;
+  ::VkDeviceSize buffer_image_granularity_ = 1;
+  std::uint32_t max_block_count_ = 0;
+  std::uint32_t block_count_ = 0;
+  std::vector<std::unique_ptr<DeviceMemoryHeap>> heaps_;
+};
+
+//------------------------------------------------------------------------------
+
+inline DeviceMemoryRange DeviceMemoryHeap::allocate(
+    const ::VkMemoryRequirements& requirements, MemoryTiling tiling) {
+  CHECK_PRECONDITION(requirements.memoryTypeBits & (1u << memory_type_index_));
+
+  ::VkDeviceSize byte_count =
+      impl::align_up(requirements.size, atom_byte_count_);
+  ::VkDeviceSize byte_alignment =
+      std::max(requirements.alignment, atom_byte_count_);
+
+  // Conservatively give optimal resources whole granularity pages so that
+  // linear neighbours on either side can never alias them.
+  if (tiling == MemoryTiling::OPTIMAL) {
+    ::VkDeviceSize granularity = allocator_->buffer_image_granularity();
+    byte_alignment = std::max(byte_alignment, granularity);
+    byte_count = impl::align_up(byte_count, granularity);
+  }
+
+  if (byte_count <= block_byte_count_ / 2) {
+    for (auto&& block : blocks_) {
+      if (auto byte_offset =
+              block->free_list().allocate(byte_count, byte_alignment)) {
+        return {block.get(), *byte_offset, byte_count};
+      }
+    }
+  }
+
+  blocks_.push_back(allocator_->allocate_block(
+      std::max(byte_count, block_byte_count_), memory_type_index_,
+      memory_flags_));
+
+  auto byte_offset =
+      blocks_.back()->free_list().allocate(byte_count, byte_alignment);
+  CHECK_POSTCONDITION(byte_offset.has_value());
+  return {blocks_.back().get(), *byte_offset, byte_count};
+}
+
+inline void DeviceMemoryHeap::free(const DeviceMemoryRange& range) {
+  auto iter = std::find_if(
+      blocks_.begin(), blocks_.end(),
+      [&range](const auto& block) { return block.get() == range.block; });
+  CHECK_PRECONDITION(iter != blocks_.end());
+
+  (*iter)->free_list().free(range.byte_offset, range.byte_count);
+
+  // Keep one block around to avoid thrashing on alloc/free cycles.
+  if ((*iter)->free_list().empty() && blocks_.size() > 1) {
+    allocator_->free_block(std::move(*iter));
+    blocks_.erase(iter);
+  }
+}
+
+inline void DeviceMemoryHeap::release(
+    const DeviceMemoryRange& range) noexcept {
+  try {
+    free(range);
+  } catch (const std::logic_error&) {
+    assert(false && "Released a range the heap didn't hand out.");
+  }
+}
+
+}  // namespace volcano
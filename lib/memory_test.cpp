@@ -0,0 +1,316 @@
+#include "lib/memory.hpp"
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+
+TEST_CASE("AlignUp") {
+  SECTION("ShouldRoundUpToAlignment") {
+    REQUIRE(impl::align_up(0, 256) == 0);
+    REQUIRE(impl::align_up(1, 256) == 256);
+    REQUIRE(impl::align_up(256, 256) == 256);
+    REQUIRE(impl::align_up(257, 256) == 512);
+  }
+
+  SECTION("ShouldIgnoreTrivialAlignment") {
+    REQUIRE(impl::align_up(13, 0) == 13);
+    REQUIRE(impl::align_up(13, 1) == 13);
+  }
+}
+
+TEST_CASE("ExpandToAtomBoundaries") {
+  SECTION("ShouldRoundOutwardsToAtoms") {
+    REQUIRE(expand_to_atom_boundaries({.byte_offset = 100, .byte_count = 10},
+                                      64, 1024) ==
+            ByteRange{.byte_offset = 64, .byte_count = 64});
+    REQUIRE(expand_to_atom_boundaries({.byte_offset = 60, .byte_count = 10},
+                                      64, 1024) ==
+            ByteRange{.byte_offset = 0, .byte_count = 128});
+  }
+
+  SECTION("ShouldClampToByteLimit") {
+    REQUIRE(expand_to_atom_boundaries({.byte_offset = 990, .byte_count = 10},
+                                      64, 1000) ==
+            ByteRange{.byte_offset = 960, .byte_count = 40});
+  }
+
+  SECTION("ShouldIgnoreTrivialAtoms") {
+    REQUIRE(expand_to_atom_boundaries({.byte_offset = 13, .byte_count = 7}, 1,
+                                      1024) ==
+            ByteRange{.byte_offset = 13, .byte_count = 7});
+  }
+}
+
+namespace {
+constexpr ::VkMemoryPropertyFlags DEVICE_LOCAL =
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+constexpr ::VkMemoryPropertyFlags HOST_VISIBLE =
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+constexpr ::VkMemoryPropertyFlags HOST_CACHED =
+    VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+constexpr std::uint32_t ALL_MEMORY_TYPES = ~0u;
+
+// Discrete GPU with a small BAR window.
+::VkPhysicalDeviceMemoryProperties make_discrete_memory_properties() {
+  return ::VkPhysicalDeviceMemoryProperties{
+      .memoryTypeCount = 5,
+      .memoryTypes =
+          {
+              {.propertyFlags = 0, .heapIndex = 1},
+              {.propertyFlags = DEVICE_LOCAL, .heapIndex = 0},
+              {.propertyFlags = HOST_VISIBLE, .heapIndex = 1},
+              {.propertyFlags = HOST_VISIBLE | HOST_CACHED, .heapIndex = 1},
+              {.propertyFlags = DEVICE_LOCAL | HOST_VISIBLE, .heapIndex = 2},
+          },
+      .memoryHeapCount = 3,
+      .memoryHeaps =
+          {
+              {.size = 8ull << 30, .flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT},
+              {.size = 16ull << 30},
+              {.size = 256ull << 20, .flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT},
+          },
+  };
+}
+
+// Integrated GPU; all memory is device local and host visible.
+::VkPhysicalDeviceMemoryProperties make_unified_memory_properties() {
+  return ::VkPhysicalDeviceMemoryProperties{
+      .memoryTypeCount = 2,
+      .memoryTypes =
+          {
+              {.propertyFlags = DEVICE_LOCAL | HOST_VISIBLE, .heapIndex = 0},
+              {.propertyFlags = DEVICE_LOCAL | HOST_VISIBLE | HOST_CACHED,
+               .heapIndex = 0},
+          },
+      .memoryHeapCount = 1,
+      .memoryHeaps =
+          {
+              {.size = 4ull << 30, .flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT},
+          },
+  };
+}
+}  // namespace
+
+TEST_CASE("SelectMemoryType") {
+  SECTION("ShouldPreferDeviceLocalOnlyForGpuOnly") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::GPU_ONLY) == 1);
+  }
+
+  SECTION("ShouldPreferWriteCombinedForUpload") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::UPLOAD) == 2);
+  }
+
+  SECTION("ShouldPreferCachedForReadback") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::READBACK) == 3);
+  }
+
+  SECTION("ShouldPreferDeviceLocalHostVisibleForDynamic") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::DYNAMIC) == 4);
+  }
+
+  SECTION("ShouldAcceptNonCoherentCachedForReadback") {
+    auto properties = make_discrete_memory_properties();
+    properties.memoryTypes[3].propertyFlags &=
+        ~VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::READBACK) == 3);
+  }
+
+  SECTION("ShouldPreferCoherentForUpload") {
+    auto properties = make_discrete_memory_properties();
+    properties.memoryTypes[0].propertyFlags =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::UPLOAD) == 2);
+    REQUIRE(select_memory_type(properties, 1u << 0, MemoryUsage::UPLOAD) ==
+            0);
+  }
+
+  SECTION("ShouldHonorMemoryTypeBits") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE(select_memory_type(properties, 1u << 3, MemoryUsage::UPLOAD) == 3);
+    REQUIRE(select_memory_type(properties, 1u << 2, MemoryUsage::READBACK) ==
+            2);
+  }
+
+  SECTION("ShouldFallBackWhenRequirementsUnmet") {
+    auto properties = make_discrete_memory_properties();
+
+    // Only a host visible type is allowed.
+    REQUIRE(select_memory_type(properties, 1u << 2, MemoryUsage::GPU_ONLY) ==
+            2);
+  }
+
+  SECTION("ShouldFailWithoutHostVisibleMemory") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE_FALSE(select_memory_type(properties, 1u << 1, MemoryUsage::UPLOAD)
+                      .has_value());
+  }
+
+  SECTION("ShouldBreakTiesByHeapSize") {
+    auto properties = make_discrete_memory_properties();
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryTypePreference{}) == 0);
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryTypePreference{
+                                   .required = DEVICE_LOCAL,
+                               }) == 1);
+  }
+
+  SECTION("ShouldSkipExoticMemoryUnlessRequired") {
+    auto properties = make_discrete_memory_properties();
+    properties.memoryTypes[1].propertyFlags |=
+        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::GPU_ONLY) == 4);
+  }
+
+  SECTION("ShouldServeAllUsagesOnUnifiedMemory") {
+    auto properties = make_unified_memory_properties();
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::GPU_ONLY) == 0);
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::UPLOAD) == 0);
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::READBACK) == 1);
+    REQUIRE(select_memory_type(properties, ALL_MEMORY_TYPES,
+                               MemoryUsage::DYNAMIC) == 0);
+  }
+}
+
+TEST_CASE("FreeList") {
+  FreeList free_list{1024};
+
+  SECTION("ShouldStartEmpty") {
+    REQUIRE(free_list.empty());
+    REQUIRE(free_list.available() == 1024);
+    REQUIRE(free_list.fragment_count() == 1);
+  }
+
+  SECTION("ShouldHonorAlignment") {
+    // Precondition.
+    auto first = free_list.allocate(10, 1);
+    REQUIRE(first == 0);
+
+    // Under Test.
+    auto second = free_list.allocate(64, 256);
+
+    // Postcondition.
+    REQUIRE(second == 256);
+    REQUIRE(free_list.available() == 1024 - 10 - 64);
+  }
+
+  SECTION("ShouldFailWhenExhausted") {
+    // Precondition.
+    REQUIRE(free_list.allocate(1024, 1) == 0);
+
+    // Under Test.
+    auto result = free_list.allocate(1, 1);
+
+    // Postcondition.
+    REQUIRE_FALSE(result.has_value());
+  }
+
+  SECTION("ShouldReuseFreedRange") {
+    // Precondition.
+    auto first = free_list.allocate(512, 1);
+    auto second = free_list.allocate(512, 1);
+    REQUIRE(first == 0);
+    REQUIRE(second == 512);
+
+    // Under Test.
+    free_list.free(*first, 512);
+    auto third = free_list.allocate(256, 1);
+
+    // Postcondition.
+    REQUIRE(third == 0);
+  }
+
+  SECTION("ShouldCoalesceNeighbours") {
+    // Precondition.
+    auto a = free_list.allocate(256, 1);
+    auto b = free_list.allocate(256, 1);
+    auto c = free_list.allocate(256, 1);
+    REQUIRE(free_list.fragment_count() == 1);
+
+    // Under Test.
+    free_list.free(*a, 256);
+    free_list.free(*c, 256);
+    REQUIRE(free_list.fragment_count() == 2);
+    free_list.free(*b, 256);
+
+    // Postcondition.
+    REQUIRE(free_list.empty());
+    REQUIRE(free_list.fragment_count() == 1);
+    REQUIRE(free_list.allocate(1024, 1) == 0);
+  }
+
+  SECTION("ShouldRejectOverlappingFree") {
+    // Precondition.
+    auto a = free_list.allocate(256, 1);
+
+    // Under Test.
+    free_list.free(*a, 256);
+
+    // Postcondition.
+    REQUIRE_THROWS_AS(free_list.free(*a, 256), std::logic_error);
+  }
+}
+
+TEST_CASE("FrameRing") {
+  FrameRing ring{2, 1024};
+
+  SECTION("ShouldSpanAllFrames") {
+    REQUIRE(ring.byte_count() == 2048);
+    REQUIRE(ring.frame_byte_offset() == 0);
+  }
+
+  SECTION("ShouldBumpWithinFrame") {
+    // Precondition.
+    ring.begin_frame(1);
+
+    // Under Test.
+    auto first = ring.allocate(10, 1);
+    auto second = ring.allocate(16, 64);
+
+    // Postcondition.
+    REQUIRE(first == 1024);
+    REQUIRE(second == 1024 + 64);
+    REQUIRE(ring.used_byte_count() == 64 + 16);
+  }
+
+  SECTION("ShouldFailPastFrameBudget") {
+    // Precondition.
+    ring.begin_frame(0);
+    REQUIRE(ring.allocate(1000, 1) == 0);
+
+    // Under Test.
+    auto result = ring.allocate(100, 1);
+
+    // Postcondition.
+    REQUIRE_FALSE(result.has_value());
+  }
+
+  SECTION("ShouldRecycleFrameOnBegin") {
+    // Precondition.
+    ring.begin_frame(0);
+    REQUIRE(ring.allocate(1024, 1) == 0);
+
+    // Under Test.
+    ring.begin_frame(0);
+
+    // Postcondition.
+    REQUIRE(ring.used_byte_count() == 0);
+    REQUIRE(ring.allocate(1024, 1) == 0);
+  }
+}
+
+}  // namespace volcano
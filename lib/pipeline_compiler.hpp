@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lib/base.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace volcano {
+
+//------------------------------------------------------------------------------
+// Threads that compile pipelines in the background, in the order they were
+// posted. Unlike `ThreadPool`, callers don't join in or wait: each job hands
+// back a future. Jobs still queued on destruction are dropped, which breaks
+// their futures; running ones finish first. Jobs capture whatever handles
+// they compile with, so destroy the compiler before the device they use.
+class PipelineCompiler final {
+ public:
+  DECLARE_COPY_DELETE(PipelineCompiler);
+  DECLARE_MOVE_DELETE(PipelineCompiler);  // Workers refer to `this`.
+
+  explicit PipelineCompiler(std::uint32_t thread_count = std::max(
+                                std::thread::hardware_concurrency(), 1u)) {
+    CHECK_PRECONDITION(thread_count > 0);
+    threads_.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; ++i) {
+      threads_.emplace_back(
+          [this](std::stop_token stop_token) { run_worker(stop_token); });
+    }
+  }
+
+  ~PipelineCompiler() {
+    for (auto&& thread : threads_) {
+      thread.request_stop();
+    }
+    {
+      std::lock_guard lock{mutex_};
+      jobs_.clear();
+    }
+    job_posted_.notify_all();
+  }
+
+  std::uint32_t thread_count() const {
+    return narrow_cast<std::uint32_t>(threads_.size());
+  }
+
+  // Runs `function()` on a worker. Its result, or what it threw, arrives
+  // through the future.
+  template <typename FunctionType>
+  std::future<std::invoke_result_t<FunctionType>> post(
+      FunctionType&& function) {
+    std::packaged_task<std::invoke_result_t<FunctionType>()> task{
+        std::forward<FunctionType>(function)};
+    auto result = task.get_future();
+    {
+      std::lock_guard lock{mutex_};
+      jobs_.emplace_back(std::move(task));
+    }
+    job_posted_.notify_one();
+    return result;
+  }
+
+ private:
+  void run_worker(std::stop_token stop_token) {
+    while (true) {
+      std::move_only_function<void()> job;
+      {
+        std::unique_lock lock{mutex_};
+        job_posted_.wait(lock, [&] {
+          return !jobs_.empty() || stop_token.stop_requested();
+        });
+        if (stop_token.stop_requested()) {
+          return;
+        }
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      job();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable job_posted_;
+  std::deque<std::move_only_function<void()>> jobs_;
+
+  // Declared last so workers stop before the state above is destroyed.
+  std::vector<std::jthread> threads_;
+};
+
+//------------------------------------------------------------------------------
+// A pipeline being compiled by a `PipelineCompiler`. Lets the renderer keep
+// drawing with a placeholder instead of stalling until it's ready. A failed
+// compile rethrows from every accessor once it has finished.
+template <typename PipelineType>
+class PendingPipeline final {
+ public:
+  DECLARE_COPY_DELETE(PendingPipeline);
+  DECLARE_MOVE_DEFAULT(PendingPipeline);
+
+  PendingPipeline() = delete;
+  ~PendingPipeline() = default;
+
+  explicit PendingPipeline(std::future<PipelineType> future)
+      : future_{std::move(future)} {
+    CHECK_PRECONDITION(future_.valid());
+  }
+
+  // Doesn't block.
+  bool is_ready() {
+    if (future_.valid() && future_.wait_for(std::chrono::seconds{0}) ==
+                               std::future_status::ready) {
+      take_result();
+    }
+    rethrow_if_failed();
+    return maybe_pipeline_.has_value();
+  }
+
+  // The compiled pipeline if it's ready, otherwise `placeholder`.
+  ::VkPipeline get_or(::VkPipeline placeholder) {
+    return is_ready() ? static_cast<::VkPipeline>(*maybe_pipeline_)
+                      : placeholder;
+  }
+
+  // Blocks until compiled.
+  PipelineType& get() {
+    if (future_.valid()) {
+      take_result();
+    }
+    rethrow_if_failed();
+    return *maybe_pipeline_;
+  }
+
+ private:
+  // `future_.get()` leaves the future empty, so keep whatever it held.
+  void take_result() {
+    try {
+      maybe_pipeline_.emplace(future_.get());
+    } catch (...) {
+      maybe_failure_ = std::current_exception();
+    }
+  }
+
+  void rethrow_if_failed() const {
+    if (maybe_failure_) {
+      std::rethrow_exception(maybe_failure_);
+    }
+  }
+
+  std::future<PipelineType> future_;
+  std::optional<PipelineType> maybe_pipeline_;
+  std::exception_ptr maybe_failure_;
+};
+
+}  // namespace volcano
@@ -0,0 +1,67 @@
+#include "lib/pipeline_compiler.hpp"
+
+#include <latch>
+#include <stdexcept>
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+
+namespace {
+struct FakePipeline final {
+  operator ::VkPipeline() const { return handle; }
+  ::VkPipeline handle = VK_NULL_HANDLE;
+};
+}  // namespace
+
+TEST_CASE("PipelineCompiler") {
+  PipelineCompiler compiler{2};
+  auto placeholder = reinterpret_cast<::VkPipeline>(0x1);
+  auto compiled = reinterpret_cast<::VkPipeline>(0x2);
+
+  SECTION("ShouldRunJobsConcurrently") {
+    // Precondition.
+    std::latch both_started{2};
+
+    // Under Test.
+    auto first = compiler.post([&] { both_started.arrive_and_wait(); });
+    auto second = compiler.post([&] { both_started.arrive_and_wait(); });
+
+    // Postcondition.
+    first.get();
+    second.get();
+    REQUIRE(compiler.thread_count() == 2);
+  }
+
+  SECTION("ShouldUsePlaceholderUntilReady") {
+    // Precondition.
+    std::latch release{1};
+    PendingPipeline<FakePipeline> pending{compiler.post([&] {
+      release.wait();
+      return FakePipeline{compiled};
+    })};
+    REQUIRE(pending.get_or(placeholder) == placeholder);
+
+    // Under Test.
+    release.count_down();
+
+    // Postcondition.
+    REQUIRE(pending.get().handle == compiled);
+    REQUIRE(pending.is_ready());
+    REQUIRE(pending.get_or(placeholder) == compiled);
+  }
+
+  SECTION("ShouldRethrowFailedCompile") {
+    // Under Test.
+    PendingPipeline<FakePipeline> pending{compiler.post(
+        []() -> FakePipeline { throw std::logic_error{"compile failed"}; })};
+
+    // Postcondition.
+    REQUIRE_THROWS_AS(pending.get(), std::logic_error);
+    REQUIRE_THROWS_AS(pending.get(), std::logic_error);
+    REQUIRE_THROWS_AS(pending.is_ready(), std::logic_error);
+    REQUIRE_THROWS_AS(pending.get_or(placeholder), std::logic_error);
+  }
+}
+
+}  // namespace volcano
@@ -0,0 +1,586 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "lib/barrier.hpp"
+#include "lib/base.hpp"
+#include "lib/memory.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace volcano {
+
+class RenderGraph;
+
+struct RenderGraphResource final {
+  std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+};
+
+//------------------------------------------------------------------------------
+// Declares what one pass reads and writes; returned by `RenderGraph::add_pass`.
+class RenderGraphPassBuilder final {
+ public:
+  DECLARE_COPY_DEFAULT(RenderGraphPassBuilder);
+  DECLARE_MOVE_DEFAULT(RenderGraphPassBuilder);
+
+  RenderGraphPassBuilder() = delete;
+  ~RenderGraphPassBuilder() = default;
+
+  std::uint32_t pass_index() const { return pass_index_; }
+
+  RenderGraphPassBuilder& read(RenderGraphResource resource,
+                               const ResourceAccess& access);
+
+  RenderGraphPassBuilder& write(RenderGraphResource resource,
+                                const ResourceAccess& access);
+
+ private:
+  friend class RenderGraph;
+
+  RenderGraphPassBuilder(RenderGraph& graph, std::uint32_t pass_index)
+      : graph_{&graph}, pass_index_{pass_index} {}
+
+  RenderGraph* graph_ = nullptr;
+  std::uint32_t pass_index_ = 0;
+};
+
+//------------------------------------------------------------------------------
+// Frame graph: passes declare the resources they read and write, and
+// `compile()` derives everything else once per change of topology.
+//
+// - Order: accesses to one resource keep the order their passes were added
+//   in wherever one of them writes: a pass reads what the last pass added
+//   before it wrote, and a write waits for the reads before it. Independent
+//   passes keep the order they were added in.
+// - Culling: only passes contributing to an imported resource or an output
+//   run.
+// - Aliasing: transient resources whose lifetimes don't overlap share memory
+//   in one heap of `transient_byte_count()` bytes; bind each at its
+//   `transient_byte_offset()`. Linear and optimal resources alive together
+//   never share a `bufferImageGranularity` page.
+// - Barriers: `execute()` records the minimal barriers before each pass, and
+//   orders aliased resources after the ones whose memory they reuse. The
+//   first use of each transient also waits for the previous `execute()`'s
+//   uses of the heap, which only orders them when both command buffers go to
+//   the same queue; otherwise give each frame in flight its own heap, or wait
+//   for the previous frame's fence or timeline value before reusing it.
+class RenderGraph final {
+ public:
+  DECLARE_COPY_DELETE(RenderGraph);
+  DECLARE_MOVE_DEFAULT(RenderGraph);
+
+  // Takes `VkPhysicalDeviceLimits::bufferImageGranularity`.
+  explicit RenderGraph(::VkDeviceSize buffer_image_granularity)
+      : buffer_image_granularity_{
+            std::max<::VkDeviceSize>(buffer_image_granularity, 1)} {}
+
+  RenderGraph() = delete;
+  ~RenderGraph() = default;
+
+  // Lives beyond the frame, eg. a swapchain image; `state` carries its
+  // synchronization from frame to frame and must outlive the graph.
+  RenderGraphResource import_buffer(ResourceState& state) {
+    return add_resource(Resource{.imported_state = &state});
+  }
+
+  RenderGraphResource import_image(::VkImage image,                         //
+                                   const ::VkImageSubresourceRange& range,  //
+                                   ResourceState& state) {
+    CHECK_PRECONDITION(image != VK_NULL_HANDLE);
+    return add_resource(Resource{
+        .image = image,
+        .range = range,
+        .imported_state = &state,
+    });
+  }
+
+  // Contents only live within the frame, so its memory may alias others'.
+  RenderGraphResource create_transient_buffer(
+      const ::VkMemoryRequirements& requirements) {
+    return add_resource(Resource{
+        .requirements = requirements,
+        .tiling = MemoryTiling::LINEAR,
+    });
+  }
+
+  // As above, for `image` created without memory.
+  RenderGraphResource create_transient_image(
+      ::VkImage image,                             //
+      const ::VkImageSubresourceRange& range,      //
+      const ::VkMemoryRequirements& requirements,  //
+      MemoryTiling tiling = MemoryTiling::OPTIMAL) {
+    CHECK_PRECONDITION(image != VK_NULL_HANDLE);
+    return add_resource(Resource{
+        .image = image,
+        .range = range,
+        .requirements = requirements,
+        .tiling = tiling,
+    });
+  }
+
+  // `record` is called from `execute()` once the pass's barriers are in.
+  RenderGraphPassBuilder add_pass(
+      std::function<void(::VkCommandBuffer)> record) {
+    CHECK_PRECONDITION(record);
+    is_compiled_ = false;
+    passes_.push_back(Pass{.record = std::move(record)});
+    return RenderGraphPassBuilder{
+        *this, narrow_cast<std::uint32_t>(passes_.size() - 1)};
+  }
+
+  // Keeps the passes producing `resource` even though nothing reads it.
+  void mark_output(RenderGraphResource resource) {
+    CHECK_PRECONDITION(resource.index < resources_.size());
+    is_compiled_ = false;
+    resources_[resource.index].is_output = true;
+  }
+
+  bool is_compiled() const { return is_compiled_; }
+
+  void compile() {
+    std::vector<Dependencies> dependencies = find_dependencies();
+    cull(dependencies);
+    order(dependencies);
+    find_lifetimes();
+    place_transients();
+    is_compiled_ = true;
+  }
+
+  // Indices of the passes `execute()` runs, in order.
+  std::span<const std::uint32_t> pass_order() const {
+    CHECK_PRECONDITION(is_compiled_);
+    return pass_order_;
+  }
+
+  bool is_culled(std::uint32_t pass_index) const {
+    CHECK_PRECONDITION(is_compiled_);
+    CHECK_PRECONDITION(pass_index < passes_.size());
+    return !passes_[pass_index].is_kept;
+  }
+
+  ::VkDeviceSize transient_byte_count() const {
+    CHECK_PRECONDITION(is_compiled_);
+    return transient_byte_count_;
+  }
+
+  // Memory types every transient resource can live in.
+  std::uint32_t transient_memory_type_bits() const {
+    CHECK_PRECONDITION(is_compiled_);
+    return transient_memory_type_bits_;
+  }
+
+  ::VkDeviceSize transient_byte_offset(RenderGraphResource resource) const {
+    CHECK_PRECONDITION(is_compiled_);
+    CHECK_PRECONDITION(resource.index < resources_.size());
+    CHECK_PRECONDITION(!resources_[resource.index].imported_state);
+    return resources_[resource.index].byte_offset;
+  }
+
+  void execute(::VkCommandBuffer command_buffer) {
+    execute(command_buffer, [](::VkCommandBuffer target,
+                               const ::VkDependencyInfo& dependency_info) {
+      ::vkCmdPipelineBarrier2(target, &dependency_info);
+    });
+  }
+
+  // As above, handing each pass's barriers to `record_barriers` rather than
+  // `vkCmdPipelineBarrier2`.
+  template <typename RecordBarriersType>
+  void execute(::VkCommandBuffer command_buffer,
+               RecordBarriersType&& record_barriers) {
+    CHECK_PRECONDITION(is_compiled_);
+
+    // The previous frame's uses of the heap, whichever resource they were.
+    ResourceState previous_heap_state;
+    for (auto&& resource : resources_) {
+      if (!resource.imported_state) {
+        add_hazards(previous_heap_state, resource.transient_state);
+      }
+      resource.transient_state = ResourceState{};
+    }
+
+    for (std::uint32_t position = 0; position < pass_order_.size();
+         ++position) {
+      const Pass& pass = passes_[pass_order_[position]];
+      for (auto&& pass_access : pass.accesses) {
+        Resource& resource = resources_[pass_access.resource_index];
+        if (resource.first_use == position && !resource.imported_state) {
+          add_hazards(resource.transient_state, previous_heap_state);
+          inherit_aliased_state(resource);
+        }
+
+        ResourceState& state = resource.state();
+        if (resource.image != VK_NULL_HANDLE) {
+          barriers_.access_image(resource.image, resource.range, state,
+                                 pass_access.access);
+        } else {
+          barriers_.access_buffer(state, pass_access.access);
+        }
+      }
+      if (const ::VkDependencyInfo* dependency_info = barriers_.resolve()) {
+        record_barriers(command_buffer, *dependency_info);
+      }
+      pass.record(command_buffer);
+    }
+  }
+
+ private:
+  friend class RenderGraphPassBuilder;
+
+  static constexpr std::uint32_t UNUSED =
+      std::numeric_limits<std::uint32_t>::max();
+
+  struct Resource final {
+    ::VkImage image = VK_NULL_HANDLE;  // Buffers need no handle for barriers.
+    ::VkImageSubresourceRange range{};
+    ResourceState* imported_state = nullptr;
+    ::VkMemoryRequirements requirements{};
+    MemoryTiling tiling = MemoryTiling::LINEAR;
+    bool is_output = false;
+
+    // Compiled; positions index `pass_order_`.
+    std::uint32_t first_use = UNUSED;
+    std::uint32_t last_use = UNUSED;
+    ::VkDeviceSize byte_offset = 0;
+    std::vector<std::uint32_t> aliased_resource_indices;  // Used earlier.
+
+    ResourceState transient_state;
+
+    ResourceState& state() {
+      return imported_state ? *imported_state : transient_state;
+    }
+  };
+
+  struct PassAccess final {
+    std::uint32_t resource_index = 0;
+    ResourceAccess access;
+    bool is_write = false;
+  };
+
+  struct Pass final {
+    std::function<void(::VkCommandBuffer)> record;
+    std::vector<PassAccess> accesses;
+    bool is_kept = false;
+  };
+
+  // Earlier passes one pass must run after, by index.
+  struct Dependencies final {
+    std::vector<std::uint32_t> producers;  // Wrote what the pass accesses.
+    std::vector<std::uint32_t> readers;    // Read what the pass overwrites.
+  };
+
+  RenderGraphResource add_resource(Resource resource) {
+    is_compiled_ = false;
+    resources_.push_back(std::move(resource));
+    return RenderGraphResource{
+        narrow_cast<std::uint32_t>(resources_.size() - 1)};
+  }
+
+  void add_access(std::uint32_t pass_index,      //
+                  RenderGraphResource resource,  //
+                  const ResourceAccess& access,  //
+                  bool is_write) {
+    CHECK_PRECONDITION(pass_index < passes_.size());
+    CHECK_PRECONDITION(resource.index < resources_.size());
+    is_compiled_ = false;
+    passes_[pass_index].accesses.push_back(PassAccess{
+        .resource_index = resource.index,
+        .access = access,
+        .is_write = is_write,
+    });
+  }
+
+  bool writes(const Pass& pass, std::uint32_t resource_index) const {
+    return std::any_of(pass.accesses.begin(), pass.accesses.end(),
+                       [resource_index](const PassAccess& pass_access) {
+                         return pass_access.is_write &&
+                                pass_access.resource_index == resource_index;
+                       });
+  }
+
+  static void add_dependency(std::vector<std::uint32_t>& dependencies,
+                             std::uint32_t pass_index,
+                             std::uint32_t dependency_index) {
+    if (dependency_index != UNUSED && dependency_index != pass_index &&
+        std::find(dependencies.begin(), dependencies.end(),
+                  dependency_index) == dependencies.end()) {
+      dependencies.push_back(dependency_index);
+    }
+  }
+
+  // Walks the passes in the order added, tracking for each resource the pass
+  // that last wrote it and the passes that read it since. A pass reading what
+  // it writes modifies it.
+  std::vector<Dependencies> find_dependencies() const {
+    std::vector<Dependencies> dependencies(passes_.size());
+    std::vector<std::uint32_t> last_writer(resources_.size(), UNUSED);
+    std::vector<std::vector<std::uint32_t>> readers(resources_.size());
+
+    for (std::uint32_t pass_i = 0; pass_i < passes_.size(); ++pass_i) {
+      auto&& pass = passes_[pass_i];
+      for (auto&& pass_access : pass.accesses) {
+        std::uint32_t resource_i = pass_access.resource_index;
+        add_dependency(dependencies[pass_i].producers, pass_i,
+                       last_writer[resource_i]);
+        if (pass_access.is_write) {
+          for (auto reader : readers[resource_i]) {
+            add_dependency(dependencies[pass_i].readers, pass_i, reader);
+          }
+        }
+      }
+
+      // Only after all of its accesses, so the pass doesn't depend on itself.
+      for (auto&& pass_access : pass.accesses) {
+        std::uint32_t resource_i = pass_access.resource_index;
+        if (writes(pass, resource_i)) {
+          last_writer[resource_i] = pass_i;
+          readers[resource_i].clear();
+        } else if (readers[resource_i].empty() ||
+                   readers[resource_i].back() != pass_i) {
+          readers[resource_i].push_back(pass_i);
+        }
+      }
+    }
+
+    return dependencies;
+  }
+
+  // Keeps the producers of kept passes. Readers a kept pass overwrites after
+  // don't contribute to it, so only order it.
+  void cull(const std::vector<Dependencies>& dependencies) {
+    std::vector<std::uint32_t> pending;
+    for (std::uint32_t pass_i = 0; pass_i < passes_.size(); ++pass_i) {
+      auto&& pass = passes_[pass_i];
+      pass.is_kept = std::any_of(
+          pass.accesses.begin(), pass.accesses.end(),
+          [this](const PassAccess& pass_access) {
+            auto&& resource = resources_[pass_access.resource_index];
+            return pass_access.is_write &&
+                   (resource.imported_state || resource.is_output);
+          });
+      if (pass.is_kept) {
+        pending.push_back(pass_i);
+      }
+    }
+
+    while (!pending.empty()) {
+      std::uint32_t pass_i = pending.back();
+      pending.pop_back();
+      for (auto producer : dependencies[pass_i].producers) {
+        if (!passes_[producer].is_kept) {
+          passes_[producer].is_kept = true;
+          pending.push_back(producer);
+        }
+      }
+    }
+  }
+
+  // Topological order of the kept passes, taking the earliest added of those
+  // ready each time.
+  void order(const std::vector<Dependencies>& dependencies) {
+    std::vector<std::uint32_t> waiting_count(passes_.size(), 0);
+    std::vector<std::vector<std::uint32_t>> successors(passes_.size());
+    auto add_edge = [&](std::uint32_t predecessor, std::uint32_t pass_i) {
+      if (passes_[predecessor].is_kept) {
+        successors[predecessor].push_back(pass_i);
+        ++waiting_count[pass_i];
+      }
+    };
+    for (std::uint32_t pass_i = 0; pass_i < passes_.size(); ++pass_i) {
+      if (!passes_[pass_i].is_kept) {
+        continue;
+      }
+      for (auto producer : dependencies[pass_i].producers) {
+        add_edge(producer, pass_i);
+      }
+      for (auto reader : dependencies[pass_i].readers) {
+        add_edge(reader, pass_i);
+      }
+    }
+
+    std::vector<std::uint32_t> ready;
+    for (std::uint32_t pass_i = 0; pass_i < passes_.size(); ++pass_i) {
+      if (passes_[pass_i].is_kept && waiting_count[pass_i] == 0) {
+        ready.push_back(pass_i);
+      }
+    }
+
+    pass_order_.clear();
+    while (!ready.empty()) {
+      auto earliest = std::min_element(ready.begin(), ready.end());
+      std::uint32_t pass_i = *earliest;
+      ready.erase(earliest);
+      pass_order_.push_back(pass_i);
+      for (auto successor : successors[pass_i]) {
+        if (--waiting_count[successor] == 0) {
+          ready.push_back(successor);
+        }
+      }
+    }
+
+    // Anything left waits on itself through a cycle.
+    CHECK_POSTCONDITION(
+        pass_order_.size() ==
+        narrow_cast<std::size_t>(
+            std::count_if(passes_.begin(), passes_.end(),
+                          [](const Pass& pass) { return pass.is_kept; })));
+  }
+
+  void find_lifetimes() {
+    for (auto&& resource : resources_) {
+      resource.first_use = UNUSED;
+      resource.last_use = UNUSED;
+      resource.aliased_resource_indices.clear();
+    }
+
+    for (std::uint32_t position = 0; position < pass_order_.size();
+         ++position) {
+      for (auto&& pass_access : passes_[pass_order_[position]].accesses) {
+        auto&& resource = resources_[pass_access.resource_index];
+        resource.first_use = std::min(resource.first_use, position);
+        resource.last_use = resource.last_use == UNUSED
+                                ? position
+                                : std::max(resource.last_use, position);
+      }
+    }
+  }
+
+  // First fit, largest first, among the resources alive at the same time.
+  void place_transients() {
+    std::vector<std::uint32_t> transient_indices;
+    transient_memory_type_bits_ = std::numeric_limits<std::uint32_t>::max();
+    for (std::uint32_t resource_i = 0; resource_i < resources_.size();
+         ++resource_i) {
+      auto&& resource = resources_[resource_i];
+      if (!resource.imported_state && resource.first_use != UNUSED) {
+        transient_indices.push_back(resource_i);
+        transient_memory_type_bits_ &= resource.requirements.memoryTypeBits;
+      }
+    }
+    std::stable_sort(transient_indices.begin(), transient_indices.end(),
+                     [this](std::uint32_t a, std::uint32_t b) {
+                       return resources_[a].requirements.size >
+                              resources_[b].requirements.size;
+                     });
+
+    struct Placed final {
+      ::VkDeviceSize begin = 0;
+      ::VkDeviceSize end = 0;
+      std::uint32_t resource_index = 0;
+    };
+    std::vector<Placed> placed;
+    std::vector<Placed> overlapping;
+    transient_byte_count_ = 0;
+
+    for (auto resource_i : transient_indices) {
+      auto&& resource = resources_[resource_i];
+      overlapping.clear();
+      for (auto&& other : placed) {
+        auto&& other_resource = resources_[other.resource_index];
+        if (!is_alive_together(resource, other_resource)) {
+          continue;
+        }
+        // Keep off the pages of neighbours with the other tiling.
+        Placed bounds = other;
+        if (other_resource.tiling != resource.tiling) {
+          bounds.begin = bounds.begin / buffer_image_granularity_ *
+                         buffer_image_granularity_;
+          bounds.end = align_up(bounds.end, buffer_image_granularity_);
+        }
+        overlapping.push_back(bounds);
+      }
+      std::sort(overlapping.begin(), overlapping.end(),
+                [](const Placed& a, const Placed& b) {
+                  return a.begin < b.begin;
+                });
+
+      ::VkDeviceSize alignment =
+          std::max<::VkDeviceSize>(resource.requirements.alignment, 1);
+      ::VkDeviceSize byte_offset = 0;
+      for (auto&& other : overlapping) {
+        if (align_up(byte_offset, alignment) + resource.requirements.size <=
+            other.begin) {
+          break;
+        }
+        byte_offset = std::max(byte_offset, other.end);
+      }
+      byte_offset = align_up(byte_offset, alignment);
+
+      resource.byte_offset = byte_offset;
+      Placed self{
+          .begin = byte_offset,
+          .end = byte_offset + resource.requirements.size,
+          .resource_index = resource_i,
+      };
+      for (auto&& other : placed) {
+        if (self.begin < other.end && other.begin < self.end) {
+          bool is_other_earlier =
+              resources_[other.resource_index].first_use < resource.first_use;
+          std::uint32_t earlier_i =
+              is_other_earlier ? other.resource_index : resource_i;
+          std::uint32_t later_i =
+              is_other_earlier ? resource_i : other.resource_index;
+          resources_[later_i].aliased_resource_indices.push_back(earlier_i);
+        }
+      }
+      placed.push_back(self);
+      transient_byte_count_ = std::max(transient_byte_count_, self.end);
+    }
+  }
+
+  static bool is_alive_together(const Resource& a, const Resource& b) {
+    return a.first_use <= b.last_use && b.first_use <= a.last_use;
+  }
+
+  static ::VkDeviceSize align_up(::VkDeviceSize value,
+                                 ::VkDeviceSize alignment) {
+    return ((value + alignment - 1) / alignment) * alignment;
+  }
+
+  // Makes every access to `earlier` a hazard of the next access to `state`,
+  // as for memory reused from a resource that is done.
+  static void add_hazards(ResourceState& state, const ResourceState& earlier) {
+    state.write_stages |= earlier.write_stages | earlier.read_stages;
+    state.write_access |= earlier.write_access;
+  }
+
+  // Memory reused from resources that are done makes their last accesses
+  // hazards of the first access here.
+  void inherit_aliased_state(Resource& resource) {
+    for (auto aliased_i : resource.aliased_resource_indices) {
+      add_hazards(resource.transient_state,
+                  resources_[aliased_i].transient_state);
+    }
+  }
+
+  ::VkDeviceSize buffer_image_granularity_ = 1;
+  std::vector<Resource> resources_;
+  std::vector<Pass> passes_;
+  bool is_compiled_ = false;
+
+  std::vector<std::uint32_t> pass_order_;
+  ::VkDeviceSize transient_byte_count_ = 0;
+  std::uint32_t transient_memory_type_bits_ = 0;
+
+  BarrierRecorder barriers_;
+};
+
+inline RenderGraphPassBuilder& RenderGraphPassBuilder::read(
+    RenderGraphResource resource, const ResourceAccess& access) {
+  graph_->add_access(pass_index_, resource, access, false);
+  return *this;
+}
+
+inline RenderGraphPassBuilder& RenderGraphPassBuilder::write(
+    RenderGraphResource resource, const ResourceAccess& access) {
+  graph_->add_access(pass_index_, resource, access, true);
+  return *this;
+}
+
+}  // namespace volcano
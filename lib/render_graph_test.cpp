@@ -0,0 +1,290 @@
+#include "lib/render_graph.hpp"
+
+#include <functional>
+#include <vector>
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+
+namespace {
+constexpr ResourceAccess COMPUTE_WRITE{
+    .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+    .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+};
+constexpr ResourceAccess COMPUTE_READ{
+    .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+    .access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+};
+constexpr ResourceAccess TRANSFER_WRITE{
+    .stages = VK_PIPELINE_STAGE_2_COPY_BIT,
+    .access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+};
+constexpr ResourceAccess TRANSFER_READ{
+    .stages = VK_PIPELINE_STAGE_2_COPY_BIT,
+    .access = VK_ACCESS_2_TRANSFER_READ_BIT,
+};
+
+void record_nothing(::VkCommandBuffer) {}
+
+// Source stages of the barriers recorded before each pass, in pass order.
+class BarrierLog final {
+ public:
+  void record_barriers(::VkCommandBuffer,
+                       const ::VkDependencyInfo& dependency_info) {
+    for (std::uint32_t i = 0; i < dependency_info.memoryBarrierCount; ++i) {
+      pending_ |= dependency_info.pMemoryBarriers[i].srcStageMask;
+    }
+  }
+
+  std::function<void(::VkCommandBuffer)> record_pass() {
+    return [this](::VkCommandBuffer) {
+      waits.push_back(pending_);
+      pending_ = VK_PIPELINE_STAGE_2_NONE;
+    };
+  }
+
+  void execute(RenderGraph& graph) {
+    waits.clear();
+    graph.execute(VK_NULL_HANDLE,
+                  [this](::VkCommandBuffer command_buffer,
+                         const ::VkDependencyInfo& dependency_info) {
+                    record_barriers(command_buffer, dependency_info);
+                  });
+  }
+
+  std::vector<::VkPipelineStageFlags2> waits;
+
+ private:
+  ::VkPipelineStageFlags2 pending_ = VK_PIPELINE_STAGE_2_NONE;
+};
+
+::VkMemoryRequirements requirements(::VkDeviceSize byte_count) {
+  return ::VkMemoryRequirements{
+      .size = byte_count,
+      .alignment = 256,
+      .memoryTypeBits = 0b11,
+  };
+}
+}  // namespace
+
+TEST_CASE("RenderGraph") {
+  RenderGraph graph{1};
+  ResourceState output_state;
+  auto output = graph.import_buffer(output_state);
+
+  SECTION("ShouldRunWritersBeforeReaders") {
+    // Precondition.
+    auto intermediate = graph.create_transient_buffer(requirements(1024));
+    auto producer =
+        graph.add_pass(record_nothing).write(intermediate, COMPUTE_WRITE);
+    auto consumer = graph.add_pass(record_nothing)
+                        .read(intermediate, COMPUTE_READ)
+                        .write(output, COMPUTE_WRITE);
+
+    // Under Test.
+    graph.compile();
+
+    // Postcondition.
+    REQUIRE(graph.is_compiled());
+    REQUIRE(std::vector<std::uint32_t>(graph.pass_order().begin(),
+                                       graph.pass_order().end()) ==
+            std::vector<std::uint32_t>{producer.pass_index(),
+                                       consumer.pass_index()});
+  }
+
+  SECTION("ShouldCullPassesNothingUses") {
+    // Precondition.
+    auto unused = graph.create_transient_buffer(requirements(1024));
+    auto used = graph.add_pass(record_nothing).write(output, COMPUTE_WRITE);
+    auto culled = graph.add_pass(record_nothing).write(unused, COMPUTE_WRITE);
+
+    // Under Test.
+    graph.compile();
+
+    // Postcondition.
+    REQUIRE_FALSE(graph.is_culled(used.pass_index()));
+    REQUIRE(graph.is_culled(culled.pass_index()));
+    REQUIRE(graph.pass_order().size() == 1);
+    REQUIRE(graph.transient_byte_count() == 0);
+  }
+
+  SECTION("ShouldKeepMarkedOutputs") {
+    // Precondition.
+    auto debug_view = graph.create_transient_buffer(requirements(1024));
+    auto debug_pass =
+        graph.add_pass(record_nothing).write(debug_view, COMPUTE_WRITE);
+    graph.mark_output(debug_view);
+
+    // Under Test.
+    graph.compile();
+
+    // Postcondition.
+    REQUIRE_FALSE(graph.is_culled(debug_pass.pass_index()));
+  }
+
+  SECTION("ShouldAliasTransientsThatAreNotAliveTogether") {
+    // Precondition.
+    auto a = graph.create_transient_buffer(requirements(4096));
+    auto b = graph.create_transient_buffer(requirements(1024));
+    auto c = graph.create_transient_buffer(requirements(2048));
+    graph.add_pass(record_nothing).write(a, COMPUTE_WRITE);
+    graph.add_pass(record_nothing)
+        .read(a, COMPUTE_READ)
+        .write(b, COMPUTE_WRITE);
+    graph.add_pass(record_nothing)
+        .read(b, COMPUTE_READ)
+        .write(c, COMPUTE_WRITE);
+    graph.add_pass(record_nothing)
+        .read(c, COMPUTE_READ)
+        .write(output, COMPUTE_WRITE);
+
+    // Under Test.
+    graph.compile();
+
+    // Postcondition.
+    REQUIRE(graph.transient_byte_offset(a) == 0);
+    REQUIRE(graph.transient_byte_offset(b) == 4096);
+    REQUIRE(graph.transient_byte_offset(c) == 0);
+    REQUIRE(graph.transient_byte_count() == 4096 + 1024);
+    REQUIRE(graph.transient_memory_type_bits() == 0b11);
+  }
+
+  SECTION("ShouldKeepLinearAndOptimalOnSeparatePages") {
+    // Precondition.
+    constexpr ::VkDeviceSize granularity = 4096;
+    RenderGraph granular_graph{granularity};
+    auto granular_output = granular_graph.import_buffer(output_state);
+    auto image = reinterpret_cast<::VkImage>(0x1);
+    auto buffer = granular_graph.create_transient_buffer(requirements(1024));
+    auto texture = granular_graph.create_transient_image(
+        image, ::VkImageSubresourceRange{}, requirements(512));
+    auto other_buffer =
+        granular_graph.create_transient_buffer(requirements(256));
+    granular_graph.add_pass(record_nothing)
+        .write(buffer, COMPUTE_WRITE)
+        .write(texture, COMPUTE_WRITE)
+        .write(other_buffer, COMPUTE_WRITE);
+    granular_graph.add_pass(record_nothing)
+        .read(buffer, COMPUTE_READ)
+        .read(texture, COMPUTE_READ)
+        .read(other_buffer, COMPUTE_READ)
+        .write(granular_output, COMPUTE_WRITE);
+
+    // Under Test.
+    granular_graph.compile();
+
+    // Postcondition.
+    REQUIRE(granular_graph.transient_byte_offset(buffer) == 0);
+    REQUIRE(granular_graph.transient_byte_offset(texture) == granularity);
+    REQUIRE(granular_graph.transient_byte_offset(other_buffer) == 1024);
+    REQUIRE(granular_graph.transient_byte_count() == granularity + 512);
+  }
+
+  SECTION("ShouldReadBeforeALaterOverwrite") {
+    // Precondition.
+    ResourceState history_state;
+    auto history = graph.import_buffer(history_state);
+    auto writer = graph.add_pass(record_nothing).write(history, COMPUTE_WRITE);
+    auto reader = graph.add_pass(record_nothing)
+                      .read(history, COMPUTE_READ)
+                      .write(output, COMPUTE_WRITE);
+    auto overwriter =
+        graph.add_pass(record_nothing).write(history, COMPUTE_WRITE);
+
+    // Under Test.
+    graph.compile();
+
+    // Postcondition.
+    REQUIRE(std::vector<std::uint32_t>(graph.pass_order().begin(),
+                                       graph.pass_order().end()) ==
+            std::vector<std::uint32_t>{writer.pass_index(),
+                                       reader.pass_index(),
+                                       overwriter.pass_index()});
+  }
+
+  SECTION("ShouldNotKeepReadersOnlyOverwrittenAfter") {
+    // Precondition.
+    ResourceState history_state;
+    auto history = graph.import_buffer(history_state);
+    auto unused = graph.create_transient_buffer(requirements(1024));
+    auto reader = graph.add_pass(record_nothing)
+                      .read(history, COMPUTE_READ)
+                      .write(unused, COMPUTE_WRITE);
+    auto overwriter =
+        graph.add_pass(record_nothing).write(history, COMPUTE_WRITE);
+
+    // Under Test.
+    graph.compile();
+
+    // Postcondition.
+    REQUIRE(graph.is_culled(reader.pass_index()));
+    REQUIRE_FALSE(graph.is_culled(overwriter.pass_index()));
+  }
+
+  SECTION("ShouldWaitForTheTransientWhoseMemoryIsReused") {
+    // Precondition.
+    BarrierLog log;
+    auto a = graph.create_transient_buffer(requirements(4096));
+    auto b = graph.create_transient_buffer(requirements(1024));
+    auto c = graph.create_transient_buffer(requirements(2048));
+    graph.add_pass(log.record_pass()).write(a, TRANSFER_WRITE);
+    graph.add_pass(log.record_pass())
+        .read(a, TRANSFER_READ)
+        .write(b, COMPUTE_WRITE);
+    graph.add_pass(log.record_pass())
+        .read(b, COMPUTE_READ)
+        .write(c, COMPUTE_WRITE);
+    graph.add_pass(log.record_pass())
+        .read(c, COMPUTE_READ)
+        .write(output, COMPUTE_WRITE);
+    graph.compile();
+    REQUIRE(graph.transient_byte_offset(c) == graph.transient_byte_offset(a));
+
+    // Under Test.
+    log.execute(graph);
+
+    // Postcondition.
+    REQUIRE(log.waits.size() == 4);
+    REQUIRE(log.waits[0] == VK_PIPELINE_STAGE_2_NONE);
+    REQUIRE(log.waits[1] == VK_PIPELINE_STAGE_2_COPY_BIT);
+    REQUIRE(log.waits[2] == (VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_2_COPY_BIT));
+    REQUIRE(log.waits[3] == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+  }
+
+  SECTION("ShouldWaitForThePreviousExecuteBeforeReusingTheHeap") {
+    // Precondition.
+    BarrierLog log;
+    auto a = graph.create_transient_buffer(requirements(1024));
+    graph.add_pass(log.record_pass()).write(a, TRANSFER_WRITE);
+    graph.add_pass(log.record_pass())
+        .read(a, COMPUTE_READ)
+        .write(output, COMPUTE_WRITE);
+    graph.compile();
+    log.execute(graph);
+    REQUIRE(log.waits[0] == VK_PIPELINE_STAGE_2_NONE);
+
+    // Under Test.
+    log.execute(graph);
+
+    // Postcondition.
+    REQUIRE(log.waits.size() == 2);
+    REQUIRE(log.waits[0] == (VK_PIPELINE_STAGE_2_COPY_BIT |
+                             VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT));
+  }
+
+  SECTION("ShouldRecompileAfterTopologyChange") {
+    // Precondition.
+    graph.add_pass(record_nothing).write(output, COMPUTE_WRITE);
+    graph.compile();
+
+    // Under Test.
+    graph.add_pass(record_nothing).read(output, COMPUTE_READ);
+
+    // Postcondition.
+    REQUIRE_FALSE(graph.is_compiled());
+  }
+}
+
+}  // namespace volcano
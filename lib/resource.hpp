@@ -2,15 +2,33 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <bitset>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <functional>
 #include <map>
+#include <mutex>
+#include <numeric>
+#include <span>
 #include <sstream>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "lib/base.hpp"
+#include "lib/memory.hpp"
+#include "lib/pipeline_compiler.hpp"
+#include "lib/spsc_queue.hpp"
 #include "lib/surface_render.hpp"
+#include "lib/thread_pool.hpp"
+#include "shaders/shaders.hpp"
 #include "vk/resource.hpp"
 
 namespace volcano {
@@ -19,6 +37,169 @@ constexpr const char* VALIDATION_LAYER_NAME = "VK_LAYER_KHRONOS_validation";
 constexpr const char* SWAPCHAIN_EXTENSION_NAME =
     VK_KHR_SWAPCHAIN_EXTENSION_NAME;
 constexpr const char* DEBUG_EXTENSION_NAME = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+
+inline ::VkImageAspectFlags format_aspect_mask(::VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_S8_UINT:
+      return VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+// Bytes per tightly packed texel of a single-aspect format, or 0 where that
+// isn't known (eg. block-compressed and combined depth-stencil formats).
+inline std::size_t format_texel_byte_count(::VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_S8_UINT:
+      return 1;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R16_SFLOAT:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_D16_UNORM:
+      return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_UINT:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+      return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+inline void record_image_layout_transition(
+    ::VkCommandBuffer command_buffer,        //
+    ::VkImage image,                         //
+    const ::VkImageSubresourceRange& range,  //
+    ::VkImageLayout old_layout,              //
+    ::VkImageLayout new_layout,              //
+    ::VkPipelineStageFlags src_stages,       //
+    ::VkAccessFlags src_access,              //
+    ::VkPipelineStageFlags dst_stages,       //
+    ::VkAccessFlags dst_access) {
+  ::VkImageMemoryBarrier barrier{
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = src_access,
+      .dstAccessMask = dst_access,
+      .oldLayout = old_layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = range,
+  };
+  ::vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0,  //
+                         0, nullptr,                                  //
+                         0, nullptr,                                  //
+                         1, std::addressof(barrier));
+}
+
+// Waits until every (or with VK_SEMAPHORE_WAIT_ANY_BIT, any one) timeline
+// semaphore reaches its value. Returns false on timeout.
+inline bool wait_semaphores(::VkDevice device,                          //
+                            std::span<const ::VkSemaphore> semaphores,  //
+                            std::span<const std::uint64_t> values,      //
+                            ::VkSemaphoreWaitFlags flags,               //
+                            std::chrono::nanoseconds timeout) {
+  CHECK_PRECONDITION(semaphores.size() == values.size());
+
+  ::VkSemaphoreWaitInfo wait_info{
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .flags = flags,
+      .semaphoreCount = narrow_cast<std::uint32_t>(semaphores.size()),
+      .pSemaphores = semaphores.data(),
+      .pValues = values.data(),
+  };
+  ::VkResult result = ::vkWaitSemaphores(device, &wait_info, timeout.count());
+  CHECK_POSTCONDITION(result == VK_SUCCESS || result == VK_TIMEOUT);
+  return result == VK_SUCCESS;
+}
+
+// Whether `data` was saved from a pipeline cache of this driver on this
+// device; anything else must not be handed back to it.
+inline bool is_pipeline_cache_compatible(
+    std::span<const std::byte> data,  //
+    const ::VkPhysicalDeviceProperties& properties) {
+  ::VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) &&
+         header.headerSize <= data.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+// Empty if `path` can't be read.
+inline std::vector<std::byte> read_file(const std::filesystem::path& path) {
+  std::ifstream file{path, std::ios::binary | std::ios::ate};
+  if (!file) {
+    return {};
+  }
+  std::streamoff byte_count = file.tellg();
+  if (byte_count < 0) {
+    return {};
+  }
+  std::vector<std::byte> result(narrow_cast<std::size_t>(byte_count));
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(result.data()),
+                 narrow_cast<std::streamsize>(result.size()))) {
+    return {};
+  }
+  return result;
+}
+
+// Writes a sibling file and renames it over `path`, so readers see either
+// the old contents or all of the new ones. Returns false on I/O failure,
+// leaving `path` untouched.
+inline bool write_file_atomically(const std::filesystem::path& path,
+                                  std::span<const std::byte> bytes) {
+  std::filesystem::path temporary_path = path;
+  temporary_path += ".tmp";
+  {
+    std::ofstream file{temporary_path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(bytes.data()),
+               narrow_cast<std::streamsize>(bytes.size()));
+    file.close();
+    if (!file) {
+      std::filesystem::remove(temporary_path);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary_path, path, error);
+  if (error) {
+    std::filesystem::remove(temporary_path, error);
+    return false;
+  }
+  return true;
+}
 }  // namespace impl
 
 enum class DebugLevel {
@@ -29,9 +210,247 @@ enum class DebugLevel {
   VERBOSE,
 };
 
+enum class QueueKind {
+  GRAPHICS,  // Also presents.
+  COMPUTE,
+  TRANSFER,
+};
+
+// Queues to create for each kind, one priority in [0.0, 1.0] per queue.
+struct DeviceQueueRequest final {
+  std::vector<float> graphics_priorities{1.0f};
+  std::vector<float> compute_priorities{1.0f};
+  std::vector<float> transfer_priorities{1.0f};
+};
+
+namespace impl {
+constexpr std::size_t QUEUE_KIND_COUNT = 3;
+
+// The queues of one kind: a contiguous run within a single family.
+struct QueueRange final {
+  std::uint32_t family_index = 0;
+  std::uint32_t first_queue_index = 0;
+  std::uint32_t queue_count = 0;
+};
+
+struct QueueFamilyRequest final {
+  std::uint32_t family_index = 0;
+  std::vector<float> priorities;  // One per queue.
+};
+
+struct QueueLayout final {
+  std::array<QueueRange, QUEUE_KIND_COUNT> ranges;  // By `QueueKind`.
+  std::vector<QueueFamilyRequest> families;         // Graphics first.
+};
+
+// Whether the two ranges hold any `VkQueue` in common.
+inline bool is_overlapping(const QueueRange& a, const QueueRange& b) {
+  return a.family_index == b.family_index &&
+         a.first_queue_index < b.first_queue_index + b.queue_count &&
+         b.first_queue_index < a.first_queue_index + a.queue_count;
+}
+
+// Gives compute and transfer their own family where the device has one:
+// compute without graphics, and transfer-only (typically a DMA engine).
+// Otherwise a kind takes the next free queues of the graphics family, or
+// shares its last queue once the family runs out.
+inline QueueLayout select_queue_layout(
+    std::span<const ::VkQueueFamilyProperties> properties,  //
+    std::uint32_t graphics_family_index,                    //
+    const DeviceQueueRequest& request) {
+  CHECK_PRECONDITION(graphics_family_index < properties.size());
+
+  auto find_family = [&](::VkQueueFlags required, ::VkQueueFlags excluded) {
+    for (std::uint32_t family_i = 0; family_i < properties.size();
+         ++family_i) {
+      if (vk::has_all_flags(properties[family_i].queueFlags, required) &&
+          !vk::has_any_flags(properties[family_i].queueFlags, excluded)) {
+        return family_i;
+      }
+    }
+    return graphics_family_index;
+  };
+
+  const std::array<std::uint32_t, QUEUE_KIND_COUNT> family_indices{
+      graphics_family_index,
+      find_family(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT),
+      find_family(VK_QUEUE_TRANSFER_BIT,
+                  VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT),
+  };
+  const std::array<const std::vector<float>*, QUEUE_KIND_COUNT> priorities{
+      std::addressof(request.graphics_priorities),
+      std::addressof(request.compute_priorities),
+      std::addressof(request.transfer_priorities),
+  };
+
+  QueueLayout result;
+  for (std::size_t kind_i = 0; kind_i < QUEUE_KIND_COUNT; ++kind_i) {
+    CHECK_PRECONDITION(priorities[kind_i]->size() > 0);
+
+    std::uint32_t family_index = family_indices[kind_i];
+    auto family = std::find_if(result.families.begin(), result.families.end(),
+                               [family_index](const QueueFamilyRequest& f) {
+                                 return f.family_index == family_index;
+                               });
+    if (family == result.families.end()) {
+      result.families.push_back({.family_index = family_index});
+      family = std::prev(result.families.end());
+    }
+
+    auto used_count = narrow_cast<std::uint32_t>(family->priorities.size());
+    std::uint32_t queue_count =
+        std::min(narrow_cast<std::uint32_t>(priorities[kind_i]->size()),
+                 properties[family_index].queueCount - used_count);
+    if (queue_count == 0) {
+      result.ranges[kind_i] = {family_index, used_count - 1, 1};
+      continue;
+    }
+
+    result.ranges[kind_i] = {family_index, used_count, queue_count};
+    family->priorities.insert(family->priorities.end(),
+                              priorities[kind_i]->begin(),
+                              priorities[kind_i]->begin() + queue_count);
+  }
+
+  return result;
+}
+}  // namespace impl
+
 class Application;
 class Instance;
+class CullingPass;
 class Device;
+class SubmissionWorker;
+class UploadService;
+
+namespace impl {
+constexpr ::VkDeviceSize DEFAULT_STAGING_BYTE_COUNT = 16ull << 20;  // MiB
+}  // namespace impl
+
+//------------------------------------------------------------------------------
+namespace impl {
+constexpr std::size_t SUBMIT_BATCH_SUBMIT_COUNT = 16;
+constexpr std::size_t SUBMIT_BATCH_COMMAND_BUFFER_COUNT = 64;
+constexpr std::size_t SUBMIT_BATCH_SEMAPHORE_COUNT = 32;  // Per direction.
+}  // namespace impl
+
+// Collects submissions, each running command buffers between semaphore waits
+// and signals, for `Queue::submit` to flush in a single `vkQueueSubmit2`.
+// Storage is inline and kept by `clear()`, so a batch is reused frame to frame
+// without allocating. Needs `Device::supports_synchronization2()`.
+class SubmitBatch final {
+ public:
+  DECLARE_COPY_DELETE(SubmitBatch);
+  DECLARE_MOVE_DEFAULT(SubmitBatch);
+
+  SubmitBatch() = default;
+  ~SubmitBatch() = default;
+
+  bool empty() const { return submit_count_ == 0; }
+  std::uint32_t submit_count() const { return submit_count_; }
+
+  // Starts the next submission; calls below add to the latest one.
+  SubmitBatch& next() {
+    CHECK_PRECONDITION(submit_count_ < submit_infos_.size());
+    submit_infos_[submit_count_++] = ::VkSubmitInfo2{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+    };
+    return *this;
+  }
+
+  // Binary semaphores ignore `value`.
+  SubmitBatch& wait(::VkSemaphore semaphore,         //
+                    ::VkPipelineStageFlags2 stages,  //
+                    std::uint64_t value = 0) {
+    CHECK_PRECONDITION(wait_count_ < wait_infos_.size());
+    wait_infos_[wait_count_++] =
+        semaphore_submit_info(semaphore, stages, value);
+    ++current().waitSemaphoreInfoCount;
+    return *this;
+  }
+
+  SubmitBatch& execute(::VkCommandBuffer command_buffer) {
+    CHECK_PRECONDITION(command_buffer_count_ < command_buffer_infos_.size());
+    command_buffer_infos_[command_buffer_count_++] =
+        ::VkCommandBufferSubmitInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+            .commandBuffer = command_buffer,
+        };
+    ++current().commandBufferInfoCount;
+    return *this;
+  }
+
+  // Binary semaphores ignore `value`.
+  SubmitBatch& signal(
+      ::VkSemaphore semaphore,  //
+      std::uint64_t value = 0,  //
+      ::VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) {
+    CHECK_PRECONDITION(signal_count_ < signal_infos_.size());
+    signal_infos_[signal_count_++] =
+        semaphore_submit_info(semaphore, stages, value);
+    ++current().signalSemaphoreInfoCount;
+    return *this;
+  }
+
+  void clear() {
+    submit_count_ = 0;
+    wait_count_ = 0;
+    command_buffer_count_ = 0;
+    signal_count_ = 0;
+  }
+
+  // Points every submission at its own run of the entries above.
+  std::span<const ::VkSubmitInfo2> submit_infos() {
+    std::size_t wait_i = 0;
+    std::size_t command_buffer_i = 0;
+    std::size_t signal_i = 0;
+    for (std::uint32_t submit_i = 0; submit_i < submit_count_; ++submit_i) {
+      auto&& submit_info = submit_infos_[submit_i];
+      submit_info.pWaitSemaphoreInfos = wait_infos_.data() + wait_i;
+      submit_info.pCommandBufferInfos =
+          command_buffer_infos_.data() + command_buffer_i;
+      submit_info.pSignalSemaphoreInfos = signal_infos_.data() + signal_i;
+      wait_i += submit_info.waitSemaphoreInfoCount;
+      command_buffer_i += submit_info.commandBufferInfoCount;
+      signal_i += submit_info.signalSemaphoreInfoCount;
+    }
+    return {submit_infos_.data(), submit_count_};
+  }
+
+ private:
+  static ::VkSemaphoreSubmitInfo semaphore_submit_info(
+      ::VkSemaphore semaphore,         //
+      ::VkPipelineStageFlags2 stages,  //
+      std::uint64_t value) {
+    CHECK_PRECONDITION(semaphore != VK_NULL_HANDLE);
+    return ::VkSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = semaphore,
+        .value = value,
+        .stageMask = stages,
+    };
+  }
+
+  ::VkSubmitInfo2& current() {
+    if (submit_count_ == 0) {
+      next();
+    }
+    return submit_infos_[submit_count_ - 1];
+  }
+
+  std::array<::VkSubmitInfo2, impl::SUBMIT_BATCH_SUBMIT_COUNT> submit_infos_;
+  std::array<::VkSemaphoreSubmitInfo, impl::SUBMIT_BATCH_SEMAPHORE_COUNT>
+      wait_infos_;
+  std::array<::VkCommandBufferSubmitInfo,
+             impl::SUBMIT_BATCH_COMMAND_BUFFER_COUNT>
+      command_buffer_infos_;
+  std::array<::VkSemaphoreSubmitInfo, impl::SUBMIT_BATCH_SEMAPHORE_COUNT>
+      signal_infos_;
+  std::uint32_t submit_count_ = 0;
+  std::uint32_t wait_count_ = 0;
+  std::uint32_t command_buffer_count_ = 0;
+  std::uint32_t signal_count_ = 0;
+};
 
 //------------------------------------------------------------------------------
 class Queue final {
@@ -66,15 +485,110 @@ class Queue final {
     CHECK_POSTCONDITION(result == VK_SUCCESS);
   }
 
+  // Orders work across queues: waits for every `wait_semaphores[i]` at
+  // `wait_pipeline_stages[i]` before running, and signals every
+  // `signal_semaphores` once done.
+  void submit(::VkCommandBuffer command_buffer,                              //
+              std::span<const ::VkSemaphore> wait_semaphores,                //
+              std::span<const ::VkPipelineStageFlags> wait_pipeline_stages,  //
+              std::span<const ::VkSemaphore> signal_semaphores,              //
+              ::VkFence maybe_signal_fence = VK_NULL_HANDLE) {
+    CHECK_PRECONDITION(wait_semaphores.size() == wait_pipeline_stages.size());
+
+    vk::SubmitInfo submit_info{::VkSubmitInfo{
+        .waitSemaphoreCount =
+            narrow_cast<std::uint32_t>(wait_semaphores.size()),
+        .pWaitSemaphores = wait_semaphores.data(),
+        .pWaitDstStageMask = wait_pipeline_stages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = std::addressof(command_buffer),
+        .signalSemaphoreCount =
+            narrow_cast<std::uint32_t>(signal_semaphores.size()),
+        .pSignalSemaphores = signal_semaphores.data(),
+    }};
+
+    ::VkResult result =
+        ::vkQueueSubmit(queue_, 1, submit_info.address(), maybe_signal_fence);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+  }
+
+  // As above, for timeline semaphores too: each semaphore pairs with the
+  // value to wait for or signal at the same position. Binary semaphores
+  // ignore their value.
+  void submit(::VkCommandBuffer command_buffer,                              //
+              std::span<const ::VkSemaphore> wait_semaphores,                //
+              std::span<const std::uint64_t> wait_values,                    //
+              std::span<const ::VkPipelineStageFlags> wait_pipeline_stages,  //
+              std::span<const ::VkSemaphore> signal_semaphores,              //
+              std::span<const std::uint64_t> signal_values,                  //
+              ::VkFence maybe_signal_fence = VK_NULL_HANDLE) {
+    CHECK_PRECONDITION(wait_semaphores.size() == wait_values.size());
+    CHECK_PRECONDITION(wait_semaphores.size() == wait_pipeline_stages.size());
+    CHECK_PRECONDITION(signal_semaphores.size() == signal_values.size());
+
+    ::VkTimelineSemaphoreSubmitInfo timeline_info{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount =
+            narrow_cast<std::uint32_t>(wait_values.size()),
+        .pWaitSemaphoreValues = wait_values.data(),
+        .signalSemaphoreValueCount =
+            narrow_cast<std::uint32_t>(signal_values.size()),
+        .pSignalSemaphoreValues = signal_values.data(),
+    };
+    vk::SubmitInfo submit_info{::VkSubmitInfo{
+        .pNext = &timeline_info,
+        .waitSemaphoreCount =
+            narrow_cast<std::uint32_t>(wait_semaphores.size()),
+        .pWaitSemaphores = wait_semaphores.data(),
+        .pWaitDstStageMask = wait_pipeline_stages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = std::addressof(command_buffer),
+        .signalSemaphoreCount =
+            narrow_cast<std::uint32_t>(signal_semaphores.size()),
+        .pSignalSemaphores = signal_semaphores.data(),
+    }};
+
+    ::VkResult result =
+        ::vkQueueSubmit(queue_, 1, submit_info.address(), maybe_signal_fence);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+  }
+
+  // Flushes every submission in `batch` at once, then clears it for reuse.
+  // Needs `Device::supports_synchronization2()`.
+  void submit(SubmitBatch& batch,
+              ::VkFence maybe_signal_fence = VK_NULL_HANDLE) {
+    CHECK_PRECONDITION(supports_synchronization2_);
+    auto submit_infos = batch.submit_infos();
+    ::VkResult result = ::vkQueueSubmit2(
+        queue_, narrow_cast<std::uint32_t>(submit_infos.size()),
+        submit_infos.data(), maybe_signal_fence);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+    batch.clear();
+  }
+
+  void submit(::VkCommandBuffer command_buffer, ::VkFence signal_fence) {
+    vk::SubmitInfo submit_info{::VkSubmitInfo{
+        .commandBufferCount = 1,
+        .pCommandBuffers = std::addressof(command_buffer),
+    }};
+
+    ::VkResult result =
+        ::vkQueueSubmit(queue_, 1, submit_info.address(), signal_fence);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+  }
+
  private:
   vk::Queue queue_;
   vk::QueueIndex index_;
+  bool supports_synchronization2_ = false;
 
   friend class Device;
 
   explicit Queue(::VkDevice device,                 //
                  std::uint32_t queue_family_index,  //
-                 std::uint32_t queue_index) {
+                 std::uint32_t queue_index,         //
+                 bool supports_synchronization2)
+      : supports_synchronization2_{supports_synchronization2} {
     CHECK_PRECONDITION(device != VK_NULL_HANDLE);
     index_ = vk::QueueIndex{queue_family_index, queue_index};
     queue_ = vk::Queue{device, index_};
@@ -102,6 +616,134 @@ class Semaphore final {
   vk::Semaphore semaphore_;
 };
 
+//------------------------------------------------------------------------------
+// Semaphore carrying a monotonically increasing 64-bit value, which both the
+// host and queue submissions can signal and wait on. Needs
+// `Device::supports_timeline_semaphore()`.
+class TimelineSemaphore final {
+ public:
+  DECLARE_COPY_DELETE(TimelineSemaphore);
+  DECLARE_MOVE_DEFAULT(TimelineSemaphore);
+
+  TimelineSemaphore() = delete;
+  ~TimelineSemaphore() = default;
+
+  operator ::VkSemaphore() const { return semaphore_.handle(); }
+
+  std::uint64_t value() const {
+    std::uint64_t result_value = 0;
+    ::VkResult result = ::vkGetSemaphoreCounterValue(
+        semaphore_.parent(), semaphore_.handle(), &result_value);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+    return result_value;
+  }
+
+  void signal(std::uint64_t value) {
+    ::VkSemaphoreSignalInfo signal_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+        .semaphore = semaphore_.handle(),
+        .value = value,
+    };
+    ::VkResult result = ::vkSignalSemaphore(semaphore_.parent(), &signal_info);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+  }
+
+  // Returns false if `timeout` passed before the value reached `value`.
+  bool wait(std::uint64_t value,  //
+            std::chrono::nanoseconds timeout =
+                std::chrono::nanoseconds::max()) const {
+    ::VkSemaphore semaphore = semaphore_.handle();
+    return impl::wait_semaphores(semaphore_.parent(), {&semaphore, 1},
+                                 {&value, 1}, 0, timeout);
+  }
+
+ private:
+  friend class Device;
+
+  explicit TimelineSemaphore(::VkDevice device, std::uint64_t initial_value) {
+    ::VkSemaphoreTypeCreateInfo type_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = initial_value,
+    };
+    semaphore_ = vk::Semaphore{device, ::VkSemaphoreCreateInfo{
+                                           .pNext = &type_info,
+                                       }};
+  }
+
+  vk::Semaphore semaphore_;
+};
+
+//------------------------------------------------------------------------------
+// Bounds the frames in flight with one timeline semaphore rather than a fence
+// per frame. The `n`th frame signals value `n` once its work completes, and
+// may only begin once frame `n - frame_count` has completed. Frame values
+// double as a clock to retire resources against. A frame's value is only
+// used up by `end_frame`, so a frame that fails before submitting is simply
+// begun again, rather than leaving a value nothing will ever signal.
+class FramePacer final {
+ public:
+  DECLARE_COPY_DELETE(FramePacer);
+  DECLARE_MOVE_DEFAULT(FramePacer);
+
+  FramePacer() = delete;
+  ~FramePacer() = default;
+
+  std::uint32_t frame_count() const { return frame_count_; }
+
+  // Slot of the current frame in [0, frame_count), eg. for per-frame pools.
+  std::uint32_t frame_index() const {
+    return narrow_cast<std::uint32_t>((frame_value_ - 1) % frame_count_);
+  }
+
+  // Value the current frame's last submission signals on `timeline()`.
+  std::uint64_t frame_value() const { return frame_value_; }
+
+  // Every frame up to this value has completed, as of `begin_frame()`.
+  std::uint64_t completed_value() const { return completed_value_; }
+
+  const TimelineSemaphore& timeline() const { return timeline_; }
+
+  // Blocks until the frame slot is free, then returns its index. Begins the
+  // same frame again if the last one wasn't ended.
+  std::uint32_t begin_frame() {
+    if (!is_frame_submitted_) {
+      return frame_index();
+    }
+    ++frame_value_;
+    is_frame_submitted_ = false;
+    if (frame_value_ > frame_count_) {
+      std::uint64_t reused_value = frame_value_ - frame_count_;
+      if (completed_value_ < reused_value) {
+        timeline_.wait(reused_value);
+        completed_value_ = reused_value;
+      }
+    }
+    return frame_index();
+  }
+
+  // Call once the queue has accepted the submission signalling
+  // `frame_value()`.
+  void end_frame() {
+    CHECK_PRECONDITION(frame_value_ > 0);
+    is_frame_submitted_ = true;
+  }
+
+ private:
+  friend class Device;
+
+  explicit FramePacer(TimelineSemaphore timeline, std::uint32_t frame_count)
+      : timeline_{std::move(timeline)}, frame_count_{frame_count} {
+    CHECK_PRECONDITION(frame_count_ > 0);
+  }
+
+  TimelineSemaphore timeline_;
+  std::uint32_t frame_count_ = 0;
+  std::uint64_t frame_value_ = 0;
+  std::uint64_t completed_value_ = 0;
+  bool is_frame_submitted_ = true;  // Before the first frame, as if ended.
+};
+
 //------------------------------------------------------------------------------
 class Fence final {
  public:
@@ -122,6 +764,12 @@ class Fence final {
     reset();
   }
 
+  bool is_signaled() const {
+    ::VkResult result = ::vkGetFenceStatus(fence_.parent(), fence_.handle());
+    CHECK_POSTCONDITION(result == VK_SUCCESS || result == VK_NOT_READY);
+    return result == VK_SUCCESS;
+  }
+
   void reset() {
     ::VkResult result =
         ::vkResetFences(fence_.parent(), 1, std::addressof(fence_.handle()));
@@ -149,126 +797,710 @@ class Buffer final {
 
   operator ::VkBuffer() const { return buffer_.handle(); }
 
+  ::VkDeviceSize byte_count() const { return buffer_.info().size; }
+  ::VkBufferUsageFlags usage() const { return buffer_.info().usage; }
+
  private:
   friend class Device;
 
-  explicit Buffer(::VkDevice device,          //
-                  ::VkDeviceSize byte_count,  //
-                  ::VkBufferUsageFlags buffer_usage) {
-    buffer_ = vk::Buffer{device, ::VkBufferCreateInfo{
-                                     .size = byte_count,
-                                     .usage = buffer_usage,
-                                     .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-                                 }};
+  explicit Buffer(::VkDevice device,                          //
+                  ::VkDeviceSize byte_count,                  //
+                  ::VkBufferUsageFlags buffer_usage,          //
+                  std::vector<std::uint32_t> queue_families)  //
+      : queue_families_{std::move(queue_families)} {
+    buffer_ = vk::Buffer{
+        device, ::VkBufferCreateInfo{
+                    .size = byte_count,
+                    .usage = buffer_usage,
+                    // Avoids ownership transfers between eg. transfer and
+                    // graphics queue families.
+                    .sharingMode = queue_families_.size() > 1
+                                       ? VK_SHARING_MODE_CONCURRENT
+                                       : VK_SHARING_MODE_EXCLUSIVE,
+                    .queueFamilyIndexCount =
+                        narrow_cast<std::uint32_t>(queue_families_.size()),
+                    .pQueueFamilyIndices = queue_families_.data(),
+                }};
     memory_requirements_ = vk::MemoryRequirements{device, buffer_};
   }
 
   vk::Buffer buffer_;
   vk::MemoryRequirements memory_requirements_;
+  std::vector<std::uint32_t> queue_families_;
+};
+
+//------------------------------------------------------------------------------
+class Image final {
+ public:
+  DECLARE_COPY_DELETE(Image);
+  DECLARE_MOVE_DEFAULT(Image);
+
+  Image() = delete;
+  ~Image() = default;
+
+  operator ::VkImage() const { return image_.handle(); }
+
+  ::VkFormat format() const { return image_.info().format; }
+  ::VkExtent2D extent() const {
+    return {image_.info().extent.width, image_.info().extent.height};
+  }
+  std::uint32_t mip_level_count() const { return image_.info().mipLevels; }
+  std::uint32_t array_layer_count() const { return image_.info().arrayLayers; }
+  ::VkImageAspectFlags aspect_mask() const {
+    return impl::format_aspect_mask(format());
+  }
+
+  MemoryTiling memory_tiling() const {
+    return image_.info().tiling == VK_IMAGE_TILING_OPTIMAL
+               ? MemoryTiling::OPTIMAL
+               : MemoryTiling::LINEAR;
+  }
+
+  // Every mip level and array layer.
+  ::VkImageSubresourceRange subresource_range() const {
+    return ::VkImageSubresourceRange{
+        .aspectMask = aspect_mask(),
+        .baseMipLevel = 0,
+        .levelCount = mip_level_count(),
+        .baseArrayLayer = 0,
+        .layerCount = array_layer_count(),
+    };
+  }
+
+ private:
+  friend class Device;
+
+  explicit Image(::VkDevice device,                          //
+                 ::VkFormat format,                          //
+                 ::VkExtent2D extent,                        //
+                 ::VkImageUsageFlags image_usage,            //
+                 std::uint32_t mip_level_count,              //
+                 std::uint32_t array_layer_count,            //
+                 ::VkImageTiling tiling,                     //
+                 std::vector<std::uint32_t> queue_families)  //
+      : queue_families_{std::move(queue_families)} {
+    CHECK_PRECONDITION(mip_level_count > 0);
+    CHECK_PRECONDITION(array_layer_count > 0);
+
+    image_ = vk::Image{
+        device, ::VkImageCreateInfo{
+                    .imageType = VK_IMAGE_TYPE_2D,
+                    .format = format,
+                    .extent = {extent.width, extent.height, 1},
+                    .mipLevels = mip_level_count,
+                    .arrayLayers = array_layer_count,
+                    .samples = VK_SAMPLE_COUNT_1_BIT,
+                    .tiling = tiling,
+                    .usage = image_usage,
+                    .sharingMode = queue_families_.size() > 1
+                                       ? VK_SHARING_MODE_CONCURRENT
+                                       : VK_SHARING_MODE_EXCLUSIVE,
+                    .queueFamilyIndexCount =
+                        narrow_cast<std::uint32_t>(queue_families_.size()),
+                    .pQueueFamilyIndices = queue_families_.data(),
+                    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                }};
+    memory_requirements_ = vk::ImageMemoryRequirements{device, image_};
+  }
+
+  vk::Image image_;
+  vk::ImageMemoryRequirements memory_requirements_;
+  std::vector<std::uint32_t> queue_families_;
 };
 
 //------------------------------------------------------------------------------
+// View of a sub-allocated range within a `DeviceMemoryBlock`.
 class DeviceMemory final {
  public:
   DECLARE_COPY_DELETE(DeviceMemory);
-  DECLARE_MOVE_DEFAULT(DeviceMemory);
 
   DeviceMemory() = delete;
-  ~DeviceMemory() = default;
+  ~DeviceMemory() {
+    if (heap_) {
+      heap_->release(range_);
+    }
+  }
 
-  void copy_initialize(std::span<const std::byte> data) {
-    CHECK_PRECONDITION(data.size() <= memory_.info().allocationSize);
-    CHECK_PRECONDITION(host_bytes_);
+  DeviceMemory(DeviceMemory&& that) noexcept
+      : heap_{std::exchange(that.heap_, nullptr)},
+        range_{std::exchange(that.range_, {})} {}
 
-    std::copy(data.begin(), data.end(), host_bytes_);
-    ::VkDevice device = memory_.parent();
-    ::vkUnmapMemory(device, memory_);
+  DeviceMemory& operator=(DeviceMemory&& that) noexcept {
+    if (this != &that) {
+      if (heap_) {
+        heap_->release(range_);
+      }
+      heap_ = std::exchange(that.heap_, nullptr);
+      range_ = std::exchange(that.range_, {});
+    }
+    return *this;
+  }
+
+  operator ::VkDeviceMemory() const { return *range_.block; }
 
-    host_bytes_ = nullptr;
+  ::VkDeviceSize byte_offset() const { return range_.byte_offset; }
+  ::VkDeviceSize byte_count() const { return range_.byte_count; }
+
+  // Empty unless the memory type is host visible.
+  std::span<std::byte> host_bytes() const {
+    if (!range_.block || !range_.block->host_bytes()) {
+      return {};
+    }
+    return {range_.block->host_bytes() + range_.byte_offset,
+            range_.byte_count};
+  }
+
+  bool is_host_coherent() const { return heap_ && heap_->is_host_coherent(); }
+
+  // Makes host writes to the given sub-range visible to the device. No-op for
+  // host coherent memory.
+  void flush(::VkDeviceSize byte_offset = 0,
+             ::VkDeviceSize byte_count = VK_WHOLE_SIZE) const {
+    if (byte_count > 0 && heap_ && heap_->is_host_visible() &&
+        !heap_->is_host_coherent()) {
+      ::VkMappedMemoryRange range =
+          mapped_memory_range(byte_offset, byte_count);
+      ::VkResult result =
+          ::vkFlushMappedMemoryRanges(range_.block->device(), 1, &range);
+      CHECK_POSTCONDITION(result == VK_SUCCESS);
+    }
+  }
+
+  // Makes device writes to the given sub-range visible to the host. No-op for
+  // host coherent memory.
+  void invalidate(::VkDeviceSize byte_offset = 0,
+                  ::VkDeviceSize byte_count = VK_WHOLE_SIZE) const {
+    if (byte_count > 0 && heap_ && heap_->is_host_visible() &&
+        !heap_->is_host_coherent()) {
+      ::VkMappedMemoryRange range =
+          mapped_memory_range(byte_offset, byte_count);
+      ::VkResult result =
+          ::vkInvalidateMappedMemoryRanges(range_.block->device(), 1, &range);
+      CHECK_POSTCONDITION(result == VK_SUCCESS);
+    }
+  }
+
+  void copy_initialize(std::span<const std::byte> data) {
+    CHECK_PRECONDITION(data.size() <= range_.byte_count);
+    CHECK_PRECONDITION(host_bytes().size());
+
+    std::copy(data.begin(), data.end(), host_bytes().begin());
+    flush(0, data.size());
   }
 
  private:
   friend class Device;
 
-  explicit DeviceMemory(::VkDevice device,                    //
-                        ::VkDeviceSize required_byte_offset,  //
-                        ::VkDeviceSize required_byte_count,   //
-                        std::uint32_t memory_type_index,      //
-                        ::VkBuffer target_buffer) {
-    memory_ =
-        vk::DeviceMemory{device, ::VkMemoryAllocateInfo{
-                                     .allocationSize = required_byte_count,
-                                     .memoryTypeIndex = memory_type_index,
-                                 }};
-
-    ::VkResult result = ::vkBindBufferMemory(device, target_buffer, memory_,
-                                             required_byte_offset);
+  // Translates a sub-range of this allocation into atom aligned block offsets.
+  ::VkMappedMemoryRange mapped_memory_range(::VkDeviceSize byte_offset,
+                                            ::VkDeviceSize byte_count) const {
+    CHECK_PRECONDITION(byte_offset <= range_.byte_count);
+    if (byte_count == VK_WHOLE_SIZE) {
+      byte_count = range_.byte_count - byte_offset;
+    }
+    CHECK_PRECONDITION(byte_offset + byte_count <= range_.byte_count);
+
+    ByteRange atom_range = expand_to_atom_boundaries(
+        {
+            .byte_offset = range_.byte_offset + byte_offset,
+            .byte_count = byte_count,
+        },
+        heap_->atom_byte_count(), range_.byte_offset + range_.byte_count);
+
+    return ::VkMappedMemoryRange{
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = *range_.block,
+        .offset = atom_range.byte_offset,
+        .size = atom_range.byte_count,
+    };
+  }
+
+  explicit DeviceMemory(InOut<DeviceMemoryHeap> heap,                //
+                        const ::VkMemoryRequirements& requirements,  //
+                        MemoryTiling tiling)
+      : heap_{heap.get()}, range_{heap_->allocate(requirements, tiling)} {}
+
+  explicit DeviceMemory(InOut<DeviceMemoryHeap> heap,                //
+                        const ::VkMemoryRequirements& requirements,  //
+                        MemoryTiling tiling,                         //
+                        ::VkBuffer target_buffer)
+      : DeviceMemory{heap, requirements, tiling} {
+    ::VkResult result =
+        ::vkBindBufferMemory(range_.block->device(), target_buffer,
+                             *range_.block, range_.byte_offset);
     CHECK_POSTCONDITION(result == VK_SUCCESS);
+  }
 
-    void* host_pointer = nullptr;
-    ::VkMemoryMapFlags flags = 0;
-    result = ::vkMapMemory(device, memory_, required_byte_offset, VK_WHOLE_SIZE,
-                           flags, std::addressof(host_pointer));
+  explicit DeviceMemory(InOut<DeviceMemoryHeap> heap,                //
+                        const ::VkMemoryRequirements& requirements,  //
+                        MemoryTiling tiling,                         //
+                        ::VkImage target_image)
+      : DeviceMemory{heap, requirements, tiling} {
+    ::VkResult result =
+        ::vkBindImageMemory(range_.block->device(), target_image,
+                            *range_.block, range_.byte_offset);
     CHECK_POSTCONDITION(result == VK_SUCCESS);
+  }
+
+  DeviceMemoryHeap* heap_ = nullptr;
+  DeviceMemoryRange range_;
+};
+
+//------------------------------------------------------------------------------
+// Persistently mapped buffer split into one region per frame in flight. Each
+// frame hands out bump-pointer sub-ranges for transient vertex/uniform data,
+// and the region is recycled when `begin_frame` is called for that frame again
+// (ie. after waiting on the frame's fence).
+class UploadRing final {
+ public:
+  DECLARE_COPY_DELETE(UploadRing);
+  DECLARE_MOVE_DEFAULT(UploadRing);
+
+  UploadRing() = delete;
+  ~UploadRing() = default;
+
+  struct Allocation final {
+    ::VkBuffer buffer = VK_NULL_HANDLE;
+    ::VkDeviceSize byte_offset = 0;
+    std::span<std::byte> host_bytes;
+  };
+
+  operator ::VkBuffer() const { return buffer_; }
+
+  std::uint32_t frame_count() const { return ring_.frame_count(); }
+  ::VkDeviceSize frame_byte_count() const { return ring_.frame_byte_count(); }
+  ::VkDeviceSize used_byte_count() const { return ring_.used_byte_count(); }
+
+  void begin_frame(std::uint32_t frame_index) {
+    ring_.begin_frame(frame_index);
+  }
+
+  // Publishes everything written to the current frame so far in one flush;
+  // call once before submitting work that reads it.
+  void flush() const {
+    if (ring_.used_byte_count() == 0) {
+      return;  // Empty ranges are invalid.
+    }
+    memory_.flush(ring_.frame_byte_offset(), ring_.used_byte_count());
+  }
+
+  Allocation allocate(::VkDeviceSize byte_count) {
+    return allocate(byte_count, byte_alignment_);
+  }
+
+  Allocation allocate(::VkDeviceSize byte_count,
+                      ::VkDeviceSize byte_alignment) {
+    auto byte_offset = ring_.allocate(byte_count, byte_alignment);
+    CHECK_PRECONDITION(byte_offset.has_value());  // Frame budget exceeded.
+
+    return Allocation{
+        .buffer = buffer_,
+        .byte_offset = *byte_offset,
+        .host_bytes = memory_.host_bytes().subspan(*byte_offset, byte_count),
+    };
+  }
+
+  // Visible to the device after the next `flush`.
+  Allocation copy(std::span<const std::byte> data) {
+    Allocation allocation = allocate(data.size());
+    std::copy(data.begin(), data.end(), allocation.host_bytes.begin());
+    return allocation;
+  }
+
+ private:
+  friend class Device;
 
-    host_bytes_ = reinterpret_cast<std::byte*>(host_pointer);
+  explicit UploadRing(Buffer buffer,                    //
+                      DeviceMemory memory,              //
+                      std::uint32_t frame_count,        //
+                      ::VkDeviceSize frame_byte_count,  //
+                      ::VkDeviceSize byte_alignment)
+      : buffer_{std::move(buffer)},
+        memory_{std::move(memory)},
+        ring_{frame_count, frame_byte_count},
+        byte_alignment_{byte_alignment} {
+    CHECK_PRECONDITION(memory_.host_bytes().size() >= ring_.byte_count());
   }
 
-  vk::DeviceMemory memory_;
-  std::byte* host_bytes_ = nullptr;
+  Buffer buffer_;
+  DeviceMemory memory_;
+  FrameRing ring_;
+  ::VkDeviceSize byte_alignment_ = 1;
 };
 
 //------------------------------------------------------------------------------
-class RenderPassCommandBuilder final {
+namespace impl {
+inline ::VkRenderPassBeginInfo render_pass_begin_info(
+    ::VkRenderPass render_pass,   //
+    ::VkFramebuffer framebuffer,  //
+    ::VkExtent2D framebuffer_extent) {
+  static std::array<::VkClearValue, 1>  //
+      clear_values{::VkClearValue{.color = {
+                                      .float32 = {0.1f, 0.1f, 0.1f, 1.0f},
+                                  }}};
+
+  return ::VkRenderPassBeginInfo{
+      .renderPass = render_pass,
+      .framebuffer = framebuffer,
+      .renderArea = {.offset = {.x = 0, .y = 0}, .extent = framebuffer_extent},
+      .clearValueCount = narrow_cast<std::uint32_t>(clear_values.size()),
+      .pClearValues = clear_values.data(),
+  };
+}
+}  // namespace impl
+
+//------------------------------------------------------------------------------
+namespace impl {
+// Byte count read by `draw_count` indirect commands laid out `byte_stride`
+// apart.
+inline ::VkDeviceSize indirect_byte_count(std::uint32_t draw_count,
+                                          std::uint32_t byte_stride,
+                                          std::size_t command_byte_count) {
+  return draw_count ? (draw_count - 1) * ::VkDeviceSize{byte_stride} +
+                          command_byte_count
+                    : 0;
+}
+
+// Draw commands shared by builders recording inside a render pass; checks
+// that every indirect read stays within its buffer.
+template <typename DerivedType>
+class DrawCommandBuilderBase {
  public:
-  DECLARE_COPY_DELETE(RenderPassCommandBuilder);
-  DECLARE_MOVE_DEFAULT(RenderPassCommandBuilder);
+  void bind(::VkPipeline pipeline) { recorder().bind_pipeline(pipeline); }
 
-  RenderPassCommandBuilder() = delete;
-  ~RenderPassCommandBuilder() = default;
+  // Graphics pipelines leave viewport and scissor dynamic, so they survive
+  // resizes; set both before the first draw.
+  void set_viewport(const ::VkViewport& viewport) {
+    CHECK_PRECONDITION(viewport.width > 0.f && viewport.height != 0.f);
+    recorder().set_viewport(viewport);
+  }
 
-  operator ::VkCommandBuffer() const { return builder_.handle(); }
+  // All of `extent`, over the full depth range.
+  void set_viewport(::VkExtent2D extent) {
+    set_viewport(::VkViewport{
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    });
+  }
 
-  void bind(::VkPipeline pipeline) { builder_.bind_pipeline(pipeline); }
+  void set_scissor(const ::VkRect2D& scissor) {
+    CHECK_PRECONDITION(scissor.offset.x >= 0 && scissor.offset.y >= 0);
+    recorder().set_scissor(scissor);
+  }
+
+  void set_scissor(::VkExtent2D extent) {
+    set_scissor(::VkRect2D{.offset = {.x = 0, .y = 0}, .extent = extent});
+  }
 
   void bind(std::uint32_t vertex_buffer_binding,
             std::span<::VkBuffer> vertex_buffers,
             std::span<::VkDeviceSize> vertex_buffer_offsets) {
-    builder_.bind_vertex_buffers(vertex_buffer_binding, vertex_buffers,
-                                 vertex_buffer_offsets);
+    recorder().bind_vertex_buffers(vertex_buffer_binding, vertex_buffers,
+                                   vertex_buffer_offsets);
   }
 
-  void draw(std::uint32_t vertex_count) { builder_.draw(vertex_count); }
+  void bind(const Buffer& index_buffer,  //
+            ::VkIndexType index_type,    //
+            ::VkDeviceSize byte_offset = 0) {
+    CHECK_PRECONDITION(index_buffer.usage() & VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    CHECK_PRECONDITION(byte_offset < index_buffer.byte_count());
+    recorder().bind_index_buffer(index_buffer, byte_offset, index_type);
+  }
+
+  void draw(std::uint32_t vertex_count, std::uint32_t instance_count = 1) {
+    recorder().draw(vertex_count, instance_count);
+  }
+
+  void draw_indexed(std::uint32_t index_count,
+                    std::uint32_t instance_count = 1,
+                    std::uint32_t first_index = 0,
+                    std::int32_t vertex_offset = 0) {
+    recorder().draw_indexed(index_count, instance_count, first_index,
+                            vertex_offset);
+  }
+
+  void draw_indirect(
+      const Buffer& buffer,        //
+      ::VkDeviceSize byte_offset,  //
+      std::uint32_t draw_count,    //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndirectCommand)) {
+    check_indirect_range(buffer, byte_offset, draw_count, byte_stride,
+                         sizeof(::VkDrawIndirectCommand));
+    recorder().draw_indirect(buffer, byte_offset, draw_count, byte_stride);
+  }
+
+  void draw_indexed_indirect(
+      const Buffer& buffer,        //
+      ::VkDeviceSize byte_offset,  //
+      std::uint32_t draw_count,    //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndexedIndirectCommand)) {
+    check_indirect_range(buffer, byte_offset, draw_count, byte_stride,
+                         sizeof(::VkDrawIndexedIndirectCommand));
+    recorder().draw_indexed_indirect(buffer, byte_offset, draw_count,
+                                     byte_stride);
+  }
+
+  // The draw count is a `std::uint32_t` at `count_byte_offset` in
+  // `count_buffer`, eg. written by a culling pass.
+  void draw_indirect_count(
+      const Buffer& buffer,              //
+      ::VkDeviceSize byte_offset,        //
+      const Buffer& count_buffer,        //
+      ::VkDeviceSize count_byte_offset,  //
+      std::uint32_t max_draw_count,      //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndirectCommand)) {
+    check_indirect_range(buffer, byte_offset, max_draw_count, byte_stride,
+                         sizeof(::VkDrawIndirectCommand));
+    check_indirect_range(count_buffer, count_byte_offset, 1, 0,
+                         sizeof(std::uint32_t));
+    recorder().draw_indirect_count(buffer, byte_offset, count_buffer,
+                                   count_byte_offset, max_draw_count,
+                                   byte_stride);
+  }
+
+  void draw_indexed_indirect_count(
+      const Buffer& buffer,              //
+      ::VkDeviceSize byte_offset,        //
+      const Buffer& count_buffer,        //
+      ::VkDeviceSize count_byte_offset,  //
+      std::uint32_t max_draw_count,      //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndexedIndirectCommand)) {
+    check_indirect_range(buffer, byte_offset, max_draw_count, byte_stride,
+                         sizeof(::VkDrawIndexedIndirectCommand));
+    check_indirect_range(count_buffer, count_byte_offset, 1, 0,
+                         sizeof(std::uint32_t));
+    recorder().draw_indexed_indirect_count(buffer, byte_offset, count_buffer,
+                                           count_byte_offset, max_draw_count,
+                                           byte_stride);
+  }
+
+ private:
+  auto& recorder() { return static_cast<DerivedType&>(*this).builder_; }
+
+  static void check_indirect_range(const Buffer& buffer,
+                                   ::VkDeviceSize byte_offset,
+                                   std::uint32_t draw_count,
+                                   std::uint32_t byte_stride,
+                                   std::size_t command_byte_count) {
+    CHECK_PRECONDITION(buffer.usage() & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    CHECK_PRECONDITION(
+        byte_offset +
+            indirect_byte_count(draw_count, byte_stride, command_byte_count) <=
+        buffer.byte_count());
+  }
+};
+}  // namespace impl
+
+//------------------------------------------------------------------------------
+class RenderPassCommandBuilder final
+    : public impl::DrawCommandBuilderBase<RenderPassCommandBuilder> {
+ public:
+  DECLARE_COPY_DELETE(RenderPassCommandBuilder);
+  DECLARE_MOVE_DEFAULT(RenderPassCommandBuilder);
+
+  RenderPassCommandBuilder() = delete;
+  ~RenderPassCommandBuilder() = default;
+
+  operator ::VkCommandBuffer() const { return builder_.handle(); }
 
  private:
   friend class CommandBufferBlock;
+  friend class impl::DrawCommandBuilderBase<RenderPassCommandBuilder>;
 
   explicit RenderPassCommandBuilder(::VkCommandBuffer command_buffer,
                                     ::VkRenderPass render_pass,
                                     ::VkFramebuffer framebuffer,
-                                    ::VkExtent2D framebuffer_extent) {
-    static std::array<::VkClearValue, 1>  //
-        clear_values{::VkClearValue{.color = {
-                                        .float32 = {0.1f, 0.1f, 0.1f, 1.0f},
-                                    }}};
-
+                                    ::VkExtent2D framebuffer_extent,
+                                    ::VkCommandBufferUsageFlags usage) {
     builder_ = vk::RenderPassCommandBuilder{
+        vk::CommandBufferBuilder{command_buffer,
+                                 ::VkCommandBufferBeginInfo{
+                                     .flags = usage,
+                                 }},
+        impl::render_pass_begin_info(render_pass, framebuffer,
+                                     framebuffer_extent)};
+  }
+
+  vk::RenderPassCommandBuilder builder_;
+};
+
+//------------------------------------------------------------------------------
+// Primary command buffer whose render pass contents come from secondary
+// command buffers, eg. those recorded by `ParallelCommandRecorder`.
+class RenderPassExecuteCommandBuilder final {
+ public:
+  DECLARE_COPY_DELETE(RenderPassExecuteCommandBuilder);
+  DECLARE_MOVE_DEFAULT(RenderPassExecuteCommandBuilder);
+
+  RenderPassExecuteCommandBuilder() = delete;
+  ~RenderPassExecuteCommandBuilder() = default;
+
+  operator ::VkCommandBuffer() const { return builder_.handle(); }
+
+  void execute(std::span<const ::VkCommandBuffer> secondary_command_buffers) {
+    builder_.execute(secondary_command_buffers);
+  }
+
+ private:
+  friend class CommandBufferBlock;
+
+  explicit RenderPassExecuteCommandBuilder(::VkCommandBuffer command_buffer,
+                                           ::VkRenderPass render_pass,
+                                           ::VkFramebuffer framebuffer,
+                                           ::VkExtent2D framebuffer_extent) {
+    builder_ = vk::RenderPassExecuteCommandBuilder{
         vk::CommandBufferBuilder{
             command_buffer,
             ::VkCommandBufferBeginInfo{
-                .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+                .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
             }},
-        ::VkRenderPassBeginInfo{
-            .renderPass = render_pass,
-            .framebuffer = framebuffer,
-            .renderArea = {.offset = {.x = 0, .y = 0},
-                           .extent = framebuffer_extent},
-            .clearValueCount = narrow_cast<std::uint32_t>(clear_values.size()),
-            .pClearValues = clear_values.data(),
+        impl::render_pass_begin_info(render_pass, framebuffer,
+                                     framebuffer_extent)};
+  }
+
+  vk::RenderPassExecuteCommandBuilder builder_;
+};
+
+//------------------------------------------------------------------------------
+// Secondary command buffer continuing one subpass of a render pass.
+class SecondaryCommandBuilder final
+    : public impl::DrawCommandBuilderBase<SecondaryCommandBuilder> {
+ public:
+  DECLARE_COPY_DELETE(SecondaryCommandBuilder);
+  DECLARE_MOVE_DEFAULT(SecondaryCommandBuilder);
+
+  SecondaryCommandBuilder() = delete;
+  ~SecondaryCommandBuilder() = default;
+
+  operator ::VkCommandBuffer() const { return builder_.handle(); }
+
+ private:
+  friend class ParallelCommandRecorder;
+  friend class impl::DrawCommandBuilderBase<SecondaryCommandBuilder>;
+
+  explicit SecondaryCommandBuilder(::VkCommandBuffer command_buffer,
+                                   ::VkRenderPass render_pass,
+                                   std::uint32_t subpass,
+                                   ::VkFramebuffer framebuffer) {
+    // Only read by `vkBeginCommandBuffer`.
+    ::VkCommandBufferInheritanceInfo inheritance_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = render_pass,
+        .subpass = subpass,
+        .framebuffer = framebuffer,
+    };
+
+    builder_ = vk::SecondaryCommandBufferBuilder{
+        command_buffer,
+        ::VkCommandBufferBeginInfo{
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                     VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+            .pInheritanceInfo = &inheritance_info,
         }};
   }
 
-  vk::RenderPassCommandBuilder builder_;
+  vk::SecondaryCommandBufferBuilder builder_;
+};
+
+//------------------------------------------------------------------------------
+// Compute work recorded into its own command buffer; submit it ahead of
+// graphics work that consumes its results.
+class ComputeCommandBuilder final {
+ public:
+  DECLARE_COPY_DELETE(ComputeCommandBuilder);
+  DECLARE_MOVE_DEFAULT(ComputeCommandBuilder);
+
+  ComputeCommandBuilder() = delete;
+  ~ComputeCommandBuilder() = default;
+
+  operator ::VkCommandBuffer() const { return builder_.handle(); }
+
+  void bind(::VkPipeline pipeline) { builder_.bind_pipeline(pipeline); }
+
+  void bind(::VkPipelineLayout pipeline_layout,  //
+            std::uint32_t first_set,             //
+            std::span<const ::VkDescriptorSet> descriptor_sets) {
+    builder_.bind_descriptor_sets(pipeline_layout, first_set,
+                                  descriptor_sets);
+  }
+
+  template <typename PushConstantsType>
+  void push_constants(::VkPipelineLayout pipeline_layout,
+                      const PushConstantsType& push_constants,
+                      std::uint32_t byte_offset = 0) {
+    static_assert(std::is_trivially_copyable_v<PushConstantsType>);
+    builder_.push_constants(pipeline_layout, byte_offset,
+                            std::as_bytes(std::span{&push_constants, 1}));
+  }
+
+  void dispatch(std::uint32_t group_count_x, std::uint32_t group_count_y = 1,
+                std::uint32_t group_count_z = 1) {
+    builder_.dispatch(group_count_x, group_count_y, group_count_z);
+  }
+
+  void dispatch_indirect(const Buffer& buffer, ::VkDeviceSize byte_offset = 0) {
+    CHECK_PRECONDITION(buffer.usage() & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    CHECK_PRECONDITION(byte_offset + sizeof(::VkDispatchIndirectCommand) <=
+                       buffer.byte_count());
+    builder_.dispatch_indirect(buffer, byte_offset);
+  }
+
+  // Fills `byte_count` bytes with repeated `value`.
+  void fill(const Buffer& buffer,        //
+            ::VkDeviceSize byte_offset,  //
+            ::VkDeviceSize byte_count,   //
+            std::uint32_t value) {
+    CHECK_PRECONDITION(buffer.usage() & VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    CHECK_PRECONDITION(byte_offset % 4 == 0 && byte_count % 4 == 0);
+    CHECK_PRECONDITION(byte_offset + byte_count <= buffer.byte_count());
+    ::vkCmdFillBuffer(builder_.handle(), buffer, byte_offset, byte_count,
+                      value);
+  }
+
+  // Copies the first `byte_count` bytes of `source` to the start of `target`.
+  void copy(const Buffer& source,  //
+            const Buffer& target,  //
+            ::VkDeviceSize byte_count) {
+    CHECK_PRECONDITION(source.usage() & VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    CHECK_PRECONDITION(target.usage() & VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    CHECK_PRECONDITION(byte_count <= source.byte_count() &&
+                       byte_count <= target.byte_count());
+    ::VkBufferCopy region{.size = byte_count};
+    ::vkCmdCopyBuffer(builder_.handle(), source, target, 1, &region);
+  }
+
+  // Global memory dependency between earlier and later commands in the queue.
+  void barrier(::VkPipelineStageFlags src_stages,  //
+               ::VkAccessFlags src_access,         //
+               ::VkPipelineStageFlags dst_stages,  //
+               ::VkAccessFlags dst_access) {
+    ::VkMemoryBarrier memory_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+    };
+    ::vkCmdPipelineBarrier(builder_.handle(), src_stages, dst_stages, 0,  //
+                           1, &memory_barrier,                            //
+                           0, nullptr,                                    //
+                           0, nullptr);
+  }
+
+ private:
+  friend class CommandBufferBlock;
+
+  explicit ComputeCommandBuilder(::VkCommandBuffer command_buffer,
+                                 ::VkCommandBufferUsageFlags usage) {
+    builder_ = vk::ComputeCommandBuilder{command_buffer,
+                                         ::VkCommandBufferBeginInfo{
+                                             .flags = usage,
+                                         }};
+  }
+
+  vk::ComputeCommandBuilder builder_;
 };
 
 //------------------------------------------------------------------------------
@@ -284,26 +1516,61 @@ class CommandBufferBlock final {
     command_buffers_.acquire_command_buffers(count);
   }
 
+  std::uint32_t size() const { return command_buffers_.size(); }
+
+  ::VkCommandBuffer operator[](std::uint32_t index) const {
+    return command_buffers_[index];
+  }
+
+  // The default usage suits buffers recorded once and resubmitted every frame;
+  // pass `VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT` for buffers re-recorded
+  // every frame from a `FrameCommandRing`.
   RenderPassCommandBuilder create_render_pass_command_builder(
       std::uint32_t command_buffer_index,  //
       ::VkRenderPass render_pass,          //
       ::VkFramebuffer framebuffer,         //
-      ::VkExtent2D framebuffer_extent) {
+      ::VkExtent2D framebuffer_extent,     //
+      ::VkCommandBufferUsageFlags usage =
+          VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT) {
     return RenderPassCommandBuilder{command_buffers_[command_buffer_index],  //
                                     render_pass,                             //
                                     framebuffer,                             //
-                                    framebuffer_extent};
+                                    framebuffer_extent,                      //
+                                    usage};
+  }
+
+  ComputeCommandBuilder create_compute_command_builder(
+      std::uint32_t command_buffer_index,  //
+      ::VkCommandBufferUsageFlags usage =
+          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT) {
+    return ComputeCommandBuilder{command_buffers_[command_buffer_index],
+                                 usage};
+  }
+
+  RenderPassExecuteCommandBuilder create_render_pass_execute_command_builder(
+      std::uint32_t command_buffer_index,  //
+      ::VkRenderPass render_pass,          //
+      ::VkFramebuffer framebuffer,         //
+      ::VkExtent2D framebuffer_extent) {
+    return RenderPassExecuteCommandBuilder{
+        command_buffers_[command_buffer_index],  //
+        render_pass,                             //
+        framebuffer,                             //
+        framebuffer_extent};
   }
 
  private:
   friend class Device;
+  friend class FrameCommandRing;
+  friend class ParallelCommandRecorder;
 
-  explicit CommandBufferBlock(::VkDevice device, ::VkCommandPool pool,
-                              std::uint32_t count) {
+  explicit CommandBufferBlock(
+      ::VkDevice device, ::VkCommandPool pool, std::uint32_t count,
+      ::VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) {
     command_buffers_ = vk::CommandBufferBlock{
         device, ::VkCommandBufferAllocateInfo{
                     .commandPool = pool,
-                    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                    .level = level,
                     .commandBufferCount = count,
                 }};
   }
@@ -330,10 +1597,15 @@ class CommandPool final {
 
  private:
   friend class Device;
+  friend class FrameCommandRing;
+  friend class ParallelCommandRecorder;
 
-  explicit CommandPool(::VkDevice device, std::uint32_t queue_family_index) {
+  explicit CommandPool(::VkDevice device,                   //
+                       std::uint32_t queue_family_index,    //
+                       ::VkCommandPoolCreateFlags flags = 0) {
     command_pool_ =
         vk::CommandPool{device, ::VkCommandPoolCreateInfo{
+                                    .flags = flags,
                                     .queueFamilyIndex = queue_family_index,
                                 }};
   }
@@ -341,6 +1613,152 @@ class CommandPool final {
   vk::CommandPool command_pool_;
 };
 
+//------------------------------------------------------------------------------
+// One command pool per frame in flight, for command buffers that are
+// re-recorded every frame. Beginning a frame resets its pool, which recycles
+// all of its command buffers at once, so it must only be called once the
+// frame's previous submission has completed (eg. its fence has signalled).
+class FrameCommandRing final {
+ public:
+  DECLARE_COPY_DELETE(FrameCommandRing);
+  DECLARE_MOVE_DEFAULT(FrameCommandRing);
+
+  FrameCommandRing() = delete;
+  ~FrameCommandRing() = default;
+
+  std::uint32_t frame_count() const {
+    return narrow_cast<std::uint32_t>(frames_.size());
+  }
+
+  std::uint32_t frame_index() const { return frame_index_; }
+
+  void begin_frame(std::uint32_t frame_index) {
+    CHECK_PRECONDITION(frame_index < frames_.size());
+    frame_index_ = frame_index;
+    frames_[frame_index_].command_pool.reset();
+  }
+
+  // Valid until the current frame is begun again.
+  CommandBufferBlock& command_buffers() {
+    return frames_[frame_index_].command_buffers;
+  }
+
+ private:
+  friend class Device;
+
+  struct Frame final {
+    CommandPool command_pool;
+    CommandBufferBlock command_buffers;
+  };
+
+  explicit FrameCommandRing(::VkDevice device,                 //
+                            std::uint32_t queue_family_index,  //
+                            std::uint32_t frame_count,         //
+                            std::uint32_t command_buffer_count) {
+    CHECK_PRECONDITION(frame_count > 0);
+    frames_.reserve(frame_count);
+    for (std::uint32_t i = 0; i < frame_count; ++i) {
+      CommandPool command_pool{device, queue_family_index,
+                               VK_COMMAND_POOL_CREATE_TRANSIENT_BIT};
+      CommandBufferBlock command_buffers{device, command_pool,
+                                         command_buffer_count};
+      frames_.push_back(Frame{
+          .command_pool = std::move(command_pool),
+          .command_buffers = std::move(command_buffers),
+      });
+    }
+  }
+
+  std::vector<Frame> frames_;
+  std::uint32_t frame_index_ = 0;
+};
+
+//------------------------------------------------------------------------------
+// Records the contents of one subpass in parallel on a `ThreadPool`. Each
+// worker owns a command pool, so recording needs no locks; the resulting
+// secondary command buffers are executed in chunk order from the primary with
+// `RenderPassExecuteCommandBuilder::execute`. Call `reset` once the GPU has
+// finished with everything recorded since the last reset.
+class ParallelCommandRecorder final {
+ public:
+  DECLARE_COPY_DELETE(ParallelCommandRecorder);
+  DECLARE_MOVE_DEFAULT(ParallelCommandRecorder);
+
+  ParallelCommandRecorder() = delete;
+  ~ParallelCommandRecorder() = default;
+
+  // Calls `record_chunk(chunk_index, SecondaryCommandBuilder&)` for every
+  // chunk in [0, chunk_count) and returns the recorded secondary command
+  // buffers in chunk order. The span is valid until the next `record`.
+  template <typename RecordFunctionType>
+  std::span<const ::VkCommandBuffer> record(
+      ::VkRenderPass render_pass,   //
+      std::uint32_t subpass,        //
+      ::VkFramebuffer framebuffer,  //
+      std::uint32_t chunk_count,    //
+      RecordFunctionType&& record_chunk) {
+    // Pools are externally synchronized, so grow them before fanning out.
+    for (auto&& worker : workers_) {
+      worker.command_buffers.acquire_command_buffers(
+          std::max(worker.command_buffers.size(),
+                   worker.used_count + chunk_count));
+    }
+    recorded_.resize(chunk_count);
+
+    thread_pool_->parallel_for(
+        chunk_count, [&](std::uint32_t worker_index, std::uint32_t chunk) {
+          Worker& worker = workers_[worker_index];
+          ::VkCommandBuffer command_buffer =
+              worker.command_buffers[worker.used_count++];
+          {
+            SecondaryCommandBuilder builder{command_buffer, render_pass,
+                                            subpass, framebuffer};
+            record_chunk(chunk, builder);
+          }
+          recorded_[chunk] = command_buffer;
+        });
+
+    return recorded_;
+  }
+
+  void reset() {
+    for (auto&& worker : workers_) {
+      worker.command_pool.reset();
+      worker.used_count = 0;
+    }
+  }
+
+ private:
+  friend class Device;
+
+  struct Worker final {
+    CommandPool command_pool;
+    CommandBufferBlock command_buffers;
+    std::uint32_t used_count = 0;
+  };
+
+  explicit ParallelCommandRecorder(::VkDevice device,        //
+                                   ThreadPool& thread_pool,  //
+                                   std::uint32_t queue_family_index)
+      : thread_pool_{&thread_pool} {
+    workers_.reserve(thread_pool.worker_count());
+    for (std::uint32_t i = 0; i < thread_pool.worker_count(); ++i) {
+      CommandPool command_pool{device, queue_family_index,
+                               VK_COMMAND_POOL_CREATE_TRANSIENT_BIT};
+      CommandBufferBlock command_buffers{device, command_pool, 0,
+                                         VK_COMMAND_BUFFER_LEVEL_SECONDARY};
+      workers_.push_back(Worker{
+          .command_pool = std::move(command_pool),
+          .command_buffers = std::move(command_buffers),
+      });
+    }
+  }
+
+  ThreadPool* thread_pool_ = nullptr;
+  std::vector<Worker> workers_;  // Indexed by worker index.
+  std::vector<::VkCommandBuffer> recorded_;
+};
+
 //------------------------------------------------------------------------------
 class ImageView final {
  public:
@@ -354,24 +1772,33 @@ class ImageView final {
 
  private:
   friend class Swapchain;
+  friend class Device;
 
-  explicit ImageView(::VkDevice device, ::VkImage image, ::VkFormat format) {
+  explicit ImageView(::VkDevice device, ::VkImage image, ::VkFormat format)
+      : ImageView{device, image, VK_IMAGE_VIEW_TYPE_2D, format,
+                  ::VkImageSubresourceRange{
+                      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                      .baseMipLevel = 0,
+                      .levelCount = VK_REMAINING_MIP_LEVELS,
+                      .baseArrayLayer = 0,
+                      .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                  }} {}
+
+  explicit ImageView(::VkDevice device,             //
+                     ::VkImage image,               //
+                     ::VkImageViewType view_type,   //
+                     ::VkFormat format,             //
+                     const ::VkImageSubresourceRange& subresource_range) {
     image_view_ = vk::ImageView{
         device, ::VkImageViewCreateInfo{
                     .image = image,
-                    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                    .viewType = view_type,
                     .format = format,
                     .components = {VK_COMPONENT_SWIZZLE_IDENTITY,  //
                                    VK_COMPONENT_SWIZZLE_IDENTITY,  //
                                    VK_COMPONENT_SWIZZLE_IDENTITY,  //
                                    VK_COMPONENT_SWIZZLE_IDENTITY},
-                    .subresourceRange = {
-                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                        .baseMipLevel = 0,
-                        .levelCount = VK_REMAINING_MIP_LEVELS,
-                        .baseArrayLayer = 0,
-                        .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                    }}};
+                    .subresourceRange = subresource_range}};
   }
 
   vk::ImageView image_view_;
@@ -426,10 +1853,14 @@ class RenderPass final {
 
   operator ::VkRenderPass() const { return render_pass_.handle(); }
 
+  // Render passes of equal format are compatible: pipelines created for one
+  // can be used in the other.
+  ::VkFormat format() const { return format_; }
+
  private:
   friend class Device;
 
-  explicit RenderPass(::VkDevice device, ::VkFormat format) {
+  explicit RenderPass(::VkDevice device, ::VkFormat format) : format_{format} {
     static std::array<::VkAttachmentDescription, 1>  //
         color_attachment{
             ::VkAttachmentDescription{
@@ -506,6 +1937,7 @@ class RenderPass final {
   }
 
   vk::RenderPass render_pass_;
+  ::VkFormat format_ = VK_FORMAT_UNDEFINED;
 };
 
 //------------------------------------------------------------------------------
@@ -522,14 +1954,68 @@ class PipelineLayout final {
  private:
   friend class Device;
 
-  explicit PipelineLayout(::VkDevice device) {
-    pipeline_layout_ =
-        vk::PipelineLayout{device, ::VkPipelineLayoutCreateInfo{}};
+  explicit PipelineLayout(
+      ::VkDevice device,                                            //
+      std::span<const ::VkDescriptorSetLayout> set_layouts,         //
+      std::span<const ::VkPushConstantRange> push_constant_ranges) {
+    pipeline_layout_ = vk::PipelineLayout{
+        device,
+        ::VkPipelineLayoutCreateInfo{
+            .setLayoutCount = narrow_cast<std::uint32_t>(set_layouts.size()),
+            .pSetLayouts = set_layouts.data(),
+            .pushConstantRangeCount =
+                narrow_cast<std::uint32_t>(push_constant_ranges.size()),
+            .pPushConstantRanges = push_constant_ranges.data(),
+        }};
   }
 
   vk::PipelineLayout pipeline_layout_;
 };
 
+//------------------------------------------------------------------------------
+// Fixed-function state of a graphics pipeline. Defaults to drawing
+// `Vertex2D_ColorF_pack` triangles, opaque and back-face culled.
+struct GraphicsPipelineState final {
+  std::vector<::VkVertexInputBindingDescription> vertex_bindings{
+      ::VkVertexInputBindingDescription{
+          .binding = 0,                 // Declare "binding 0".
+          .stride = 5 * sizeof(float),  // sizeof(Vertex2D_ColorF_pack)
+          .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+      },
+  };
+  std::vector<::VkVertexInputAttributeDescription> vertex_attributes{
+      ::VkVertexInputAttributeDescription{
+          .location = 0,  // Declare "location 0".
+          .binding = 0,   // Wrt. "binding 0".
+          .format = VK_FORMAT_R32G32_SFLOAT,
+          // offsetof(Vertex2D_ColorF_pack, position)
+          .offset = 0 * sizeof(float),
+      },
+      ::VkVertexInputAttributeDescription{
+          .location = 1,  // Declare "location 1".
+          .binding = 0,   // Wrt. "binding 0".
+          .format = VK_FORMAT_R32G32B32_SFLOAT,
+          // offsetof(Vertex2D_ColorF_pack, color)
+          .offset = 2 * sizeof(float),
+      },
+  };
+  ::VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  ::VkPolygonMode polygon_mode = VK_POLYGON_MODE_FILL;
+  ::VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+  ::VkFrontFace front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  ::VkPipelineColorBlendAttachmentState color_blend{
+      .blendEnable = VK_FALSE,
+      .srcColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+      .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+      .colorBlendOp = VK_BLEND_OP_ADD,
+      .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+      .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+      .alphaBlendOp = VK_BLEND_OP_ADD,
+      .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+  };
+};
+
 //------------------------------------------------------------------------------
 class GraphicsPipeline final {
  public:
@@ -545,11 +2031,12 @@ class GraphicsPipeline final {
   friend class Device;
 
   explicit GraphicsPipeline(::VkDevice device,  //
+                            ::VkPipelineCache cache,
                             ::VkShaderModule vertex_shader,
                             ::VkShaderModule fragment_shader,
                             ::VkPipelineLayout pipeline_layout,
                             ::VkRenderPass render_pass,
-                            ::VkExtent2D surface_extent) {
+                            const GraphicsPipelineState& state) {
     std::array<::VkPipelineShaderStageCreateInfo, 2> shader_stage_info{
         ::VkPipelineShaderStageCreateInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -565,79 +2052,49 @@ class GraphicsPipeline final {
         },
     };
 
-    std::array<::VkVertexInputBindingDescription, 1>  //
-        vertex_input_binding_desc{
-            ::VkVertexInputBindingDescription{
-                .binding = 0,                 // Declare "binding 0".
-                .stride = 5 * sizeof(float),  // sizeof(Vertex2D_ColorF_pack)
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-            },
-        };
-
-    std::array<::VkVertexInputAttributeDescription, 2>  //
-        vertex_input_attribute_desc{
-            ::VkVertexInputAttributeDescription{
-                .location = 0,  // Declare "location 0".
-                .binding = 0,   // Wrt. "binding 0".
-                .format = VK_FORMAT_R32G32_SFLOAT,
-                // offsetof(Vertex2D_ColorF_pack, position)
-                .offset = 0 * sizeof(float),
-            },
-            ::VkVertexInputAttributeDescription{
-                .location = 1,  // Declare "location 1".
-                .binding = 0,   // Wrt. "binding 0".
-                .format = VK_FORMAT_R32G32B32_SFLOAT,
-                // offsetof(Vertex2D_ColorF_pack, color)
-                .offset = 2 * sizeof(float),
-            },
-        };
-
     ::VkPipelineVertexInputStateCreateInfo vertex_input_state_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
         .vertexBindingDescriptionCount =
-            narrow_cast<std::uint32_t>(vertex_input_binding_desc.size()),
-        .pVertexBindingDescriptions = vertex_input_binding_desc.data(),
+            narrow_cast<std::uint32_t>(state.vertex_bindings.size()),
+        .pVertexBindingDescriptions = state.vertex_bindings.data(),
         .vertexAttributeDescriptionCount =
-            narrow_cast<std::uint32_t>(vertex_input_attribute_desc.size()),
-        .pVertexAttributeDescriptions = vertex_input_attribute_desc.data(),
+            narrow_cast<std::uint32_t>(state.vertex_attributes.size()),
+        .pVertexAttributeDescriptions = state.vertex_attributes.data(),
     };
 
-    static ::VkPipelineInputAssemblyStateCreateInfo input_assembly_state_info{
+    ::VkPipelineInputAssemblyStateCreateInfo input_assembly_state_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .topology = state.topology,
         .primitiveRestartEnable = VK_FALSE,
     };
 
-    std::array<::VkViewport, 1> viewports{
-        ::VkViewport{
-            .x = 0.f,
-            .y = 0.f,
-            .width = static_cast<float>(surface_extent.width),
-            .height = static_cast<float>(surface_extent.height),
-            .minDepth = 0.f,
-            .maxDepth = 1.f,
-        },
+    // Set when recording, so the pipeline doesn't depend on the extent.
+    static ::VkPipelineViewportStateCreateInfo viewport_state_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .pViewports = nullptr,
+        .scissorCount = 1,
+        .pScissors = nullptr,
     };
 
-    std::array<::VkRect2D, 1> scissors{
-        ::VkRect2D{.offset = {.x = 0, .y = 0}, .extent = surface_extent},
+    static const std::array<::VkDynamicState, 2> dynamic_states{
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
     };
 
-    ::VkPipelineViewportStateCreateInfo viewport_state_info{
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = narrow_cast<std::uint32_t>(viewports.size()),
-        .pViewports = viewports.data(),
-        .scissorCount = narrow_cast<std::uint32_t>(scissors.size()),
-        .pScissors = scissors.data(),
+    static ::VkPipelineDynamicStateCreateInfo dynamic_state_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = narrow_cast<std::uint32_t>(dynamic_states.size()),
+        .pDynamicStates = dynamic_states.data(),
     };
 
-    static ::VkPipelineRasterizationStateCreateInfo rasterization_state_info{
+    ::VkPipelineRasterizationStateCreateInfo rasterization_state_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
         .depthClampEnable = VK_FALSE,
         .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .cullMode = VK_CULL_MODE_BACK_BIT,
-        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .polygonMode = state.polygon_mode,
+        .cullMode = state.cull_mode,
+        .frontFace = state.front_face,
         .depthBiasEnable = VK_FALSE,
         .lineWidth = 1.f,
     };
@@ -650,34 +2107,17 @@ class GraphicsPipeline final {
         .alphaToOneEnable = VK_FALSE,
     };
 
-    static std::array<::VkPipelineColorBlendAttachmentState, 1>  //
-        color_blend_attchment_state{
-            ::VkPipelineColorBlendAttachmentState{
-                .blendEnable = VK_FALSE,
-                .srcColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-                .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-                .colorBlendOp = VK_BLEND_OP_ADD,
-                .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-                .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-                .alphaBlendOp = VK_BLEND_OP_ADD,
-                .colorWriteMask =
-                    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                    VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-            },
-        };
-
-    static ::VkPipelineColorBlendStateCreateInfo color_blend_state_info{
+    ::VkPipelineColorBlendStateCreateInfo color_blend_state_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
         .logicOpEnable = VK_FALSE,
         .logicOp = VK_LOGIC_OP_COPY,
-        .attachmentCount =
-            narrow_cast<std::uint32_t>(color_blend_attchment_state.size()),
-        .pAttachments = color_blend_attchment_state.data(),
+        .attachmentCount = 1,
+        .pAttachments = std::addressof(state.color_blend),
         .blendConstants = {0.f, 0.f, 0.f, 0.f},
     };
 
-    pipeline_ = vk::GraphicsPipeline{
-        device,
+    pipeline_ = vk::create_graphics_pipeline(
+        device, cache,
         ::VkGraphicsPipelineCreateInfo{
             .stageCount = narrow_cast<std::uint32_t>(shader_stage_info.size()),
             .pStages = shader_stage_info.data(),
@@ -689,16 +2129,203 @@ class GraphicsPipeline final {
             .pMultisampleState = std::addressof(multisample_state_info),
             .pDepthStencilState = nullptr,
             .pColorBlendState = std::addressof(color_blend_state_info),
-            .pDynamicState = nullptr,
+            .pDynamicState = std::addressof(dynamic_state_info),
             .layout = pipeline_layout,
             .renderPass = render_pass,
             .subpass = 0,
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = -1,
-        }};
+        });
+  }
+
+  vk::GraphicsPipeline pipeline_;
+};
+
+//------------------------------------------------------------------------------
+class ComputePipeline final {
+ public:
+  DECLARE_COPY_DELETE(ComputePipeline);
+  DECLARE_MOVE_DEFAULT(ComputePipeline);
+
+  ComputePipeline() = delete;
+  ~ComputePipeline() = default;
+
+  operator ::VkPipeline() const { return pipeline_.handle(); }
+
+ private:
+  friend class Device;
+
+  explicit ComputePipeline(::VkDevice device,                //
+                           ::VkPipelineCache cache,          //
+                           ::VkShaderModule compute_shader,  //
+                           ::VkPipelineLayout pipeline_layout) {
+    ::VkPipelineShaderStageCreateInfo shader_stage_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+        .module = compute_shader,
+        .pName = "main",  // Entry point for compute shader in module.
+    };
+
+    pipeline_ = vk::create_compute_pipeline(
+        device, cache,
+        ::VkComputePipelineCreateInfo{
+            .stage = shader_stage_info,
+            .layout = pipeline_layout,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = -1,
+        });
+  }
+
+  vk::ComputePipeline pipeline_;
+};
+
+//------------------------------------------------------------------------------
+namespace impl {
+constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+constexpr std::uint64_t FNV_PRIME = 0x100000001b3;
+
+// Hashes and compares values by their bytes, which is only sound for types
+// whose equal values have equal bytes: no padding, floats or pointees.
+class ContentHasher final {
+ public:
+  template <typename Type>
+  ContentHasher& add(std::span<const Type> values) {
+    static_assert(std::has_unique_object_representations_v<Type>);
+    std::size_t count = values.size();  // So [a][bc] and [ab][c] differ.
+    add_bytes(std::as_bytes(std::span{&count, 1}));
+    add_bytes(std::as_bytes(values));
+    return *this;
+  }
+
+  template <typename Type>
+  ContentHasher& add(const Type& value) {
+    static_assert(std::has_unique_object_representations_v<Type>);
+    add_bytes(std::as_bytes(std::span{&value, 1}));
+    return *this;
+  }
+
+  std::size_t hash() const { return static_cast<std::size_t>(hash_); }
+
+ private:
+  void add_bytes(std::span<const std::byte> bytes) {
+    for (std::byte byte : bytes) {
+      hash_ = (hash_ ^ std::to_integer<std::uint64_t>(byte)) * FNV_PRIME;
+    }
+  }
+
+  std::uint64_t hash_ = FNV_OFFSET_BASIS;
+};
+
+template <typename Type>
+bool is_content_equal(std::span<const Type> a, std::span<const Type> b) {
+  static_assert(std::has_unique_object_representations_v<Type>);
+  return a.size() == b.size() &&
+         (a.empty() || std::memcmp(a.data(), b.data(), a.size_bytes()) == 0);
+}
+
+template <typename Type>
+bool is_content_equal(const Type& a, const Type& b) {
+  return is_content_equal(std::span{&a, 1}, std::span{&b, 1});
+}
+}  // namespace impl
+
+// What a `PipelineLayout` is created from.
+struct PipelineLayoutKey final {
+  std::vector<::VkDescriptorSetLayout> set_layouts;
+  std::vector<::VkPushConstantRange> push_constant_ranges;
+
+  bool operator==(const PipelineLayoutKey& that) const {
+    return impl::is_content_equal<::VkDescriptorSetLayout>(  //
+               set_layouts, that.set_layouts) &&
+           impl::is_content_equal<::VkPushConstantRange>(
+               push_constant_ranges, that.push_constant_ranges);
   }
+};
 
-  vk::GraphicsPipeline pipeline_;
+struct PipelineLayoutKeyHash final {
+  std::size_t operator()(const PipelineLayoutKey& key) const {
+    return impl::ContentHasher{}
+        .add<::VkDescriptorSetLayout>(key.set_layouts)
+        .add<::VkPushConstantRange>(key.push_constant_ranges)
+        .hash();
+  }
+};
+
+// What a `GraphicsPipeline` is created from, up to render pass
+// compatibility. Pipelines of equal keys are interchangeable.
+struct GraphicsPipelineKey final {
+  ::VkShaderModule vertex_shader = VK_NULL_HANDLE;
+  ::VkShaderModule fragment_shader = VK_NULL_HANDLE;
+  ::VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+  ::VkFormat render_pass_format = VK_FORMAT_UNDEFINED;
+  GraphicsPipelineState state;
+
+  bool operator==(const GraphicsPipelineKey& that) const {
+    using impl::is_content_equal;
+    return vertex_shader == that.vertex_shader &&
+           fragment_shader == that.fragment_shader &&
+           pipeline_layout == that.pipeline_layout &&
+           render_pass_format == that.render_pass_format &&
+           is_content_equal<::VkVertexInputBindingDescription>(
+               state.vertex_bindings, that.state.vertex_bindings) &&
+           is_content_equal<::VkVertexInputAttributeDescription>(
+               state.vertex_attributes, that.state.vertex_attributes) &&
+           state.topology == that.state.topology &&
+           state.polygon_mode == that.state.polygon_mode &&
+           state.cull_mode == that.state.cull_mode &&
+           state.front_face == that.state.front_face &&
+           is_content_equal(state.color_blend, that.state.color_blend);
+  }
+};
+
+struct GraphicsPipelineKeyHash final {
+  std::size_t operator()(const GraphicsPipelineKey& key) const {
+    return impl::ContentHasher{}
+        .add(key.vertex_shader)
+        .add(key.fragment_shader)
+        .add(key.pipeline_layout)
+        .add(key.render_pass_format)
+        .add<::VkVertexInputBindingDescription>(key.state.vertex_bindings)
+        .add<::VkVertexInputAttributeDescription>(key.state.vertex_attributes)
+        .add(key.state.topology)
+        .add(key.state.polygon_mode)
+        .add(key.state.cull_mode)
+        .add(key.state.front_face)
+        .add(key.state.color_blend)
+        .hash();
+  }
+};
+
+//------------------------------------------------------------------------------
+// Pipelines and layouts the device deduplicated by content, so rebuilding
+// what already exists (eg. on every swapchain resize) costs a hash lookup.
+class PipelineRegistry final {
+ public:
+  DECLARE_COPY_DELETE(PipelineRegistry);
+  DECLARE_MOVE_DEFAULT(PipelineRegistry);
+
+  PipelineRegistry() = default;
+  ~PipelineRegistry() = default;
+
+  // Of graphics pipeline lookups.
+  std::uint64_t hit_count() const { return hit_count_; }
+  std::uint64_t miss_count() const { return miss_count_; }
+
+  std::size_t graphics_pipeline_count() const {
+    return graphics_pipelines_.size();
+  }
+
+ private:
+  friend class Device;
+
+  std::unordered_map<PipelineLayoutKey, PipelineLayout, PipelineLayoutKeyHash>
+      pipeline_layouts_;
+  std::unordered_map<GraphicsPipelineKey,  //
+                     GraphicsPipeline,     //
+                     GraphicsPipelineKeyHash>
+      graphics_pipelines_;
+  std::uint64_t hit_count_ = 0;
+  std::uint64_t miss_count_ = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -769,9 +2396,11 @@ class Swapchain final {
     return next_image_index;
   }
 
-  void present(std::uint32_t image_index,  //
-               ::VkQueue queue,            //
-               ::VkSemaphore wait_semaphore) {
+  // Returns `VK_SUBOPTIMAL_KHR` or `VK_ERROR_OUT_OF_DATE_KHR` when the
+  // swapchain should be recreated.
+  ::VkResult present(std::uint32_t image_index,  //
+                     ::VkQueue queue,            //
+                     ::VkSemaphore wait_semaphore) {
     vk::PresentInfo present_info{::VkPresentInfoKHR{
         .waitSemaphoreCount = 1,
         .pWaitSemaphores = std::addressof(wait_semaphore),
@@ -786,6 +2415,7 @@ class Swapchain final {
                         result ==
                             VK_ERROR_SURFACE_LOST_KHR ||  // Recreate surface.
                         result == VK_SUBOPTIMAL_KHR);
+    return result;
   }
 
  private:
@@ -856,7 +2486,8 @@ class Swapchain final {
 class Device final {
  public:
   DECLARE_COPY_DELETE(Device);
-  DECLARE_MOVE_DEFAULT(Device);
+  // Helpers like `UploadService` keep a pointer to their device.
+  DECLARE_MOVE_DELETE(Device);
 
   Device() = delete;
   ~Device() = default;
@@ -866,9 +2497,66 @@ class Device final {
     CHECK_POSTCONDITION(result == VK_SUCCESS);
   }
 
-  Queue create_queue() {
-    CHECK_PRECONDITION(queue_families_.size() == 1);
-    return Queue{device_, queue_families_.front(), 0u};
+  // The `queue_index`th queue of `kind`, below `queue_count(kind)`. Queues of
+  // different kinds run concurrently when their families differ; order work
+  // between them with semaphores. Kinds may wrap the same `VkQueue` when a
+  // family runs out (see `shares_queue`), and `VkQueue` submission isn't
+  // thread safe, so such queues must be submitted from one thread at a time.
+  Queue create_queue(QueueKind kind = QueueKind::GRAPHICS,
+                     std::uint32_t queue_index = 0) {
+    auto&& range = queue_range(kind);
+    CHECK_PRECONDITION(queue_index < range.queue_count);
+    return Queue{device_, range.family_index,
+                 range.first_queue_index + queue_index,
+                 supports_synchronization2()};
+  }
+
+  // Transfer-only queue if the device has one, otherwise a graphics queue.
+  Queue create_transfer_queue() { return create_queue(QueueKind::TRANSFER); }
+
+  std::uint32_t queue_count(QueueKind kind) const {
+    return queue_range(kind).queue_count;
+  }
+
+  std::uint32_t queue_family_index(QueueKind kind) const {
+    return queue_range(kind).family_index;
+  }
+
+  std::uint32_t transfer_queue_family_index() const {
+    return queue_family_index(QueueKind::TRANSFER);
+  }
+
+  // Whether queues created for `a` and `b` may be the same `VkQueue`, eg.
+  // when an `UploadService` and a `SubmissionWorker` would otherwise submit
+  // to it from different threads without a lock.
+  bool shares_queue(QueueKind a, QueueKind b) const {
+    return impl::is_overlapping(queue_range(a), queue_range(b));
+  }
+
+  // Whether `kind` runs on its own family rather than sharing graphics'.
+  bool has_dedicated_queue_family(QueueKind kind) const {
+    return kind == QueueKind::GRAPHICS ||
+           queue_family_index(kind) != queue_family_index(QueueKind::GRAPHICS);
+  }
+
+  // Enables `draw_indirect` and friends to read more than one command.
+  bool supports_multi_draw_indirect() const {
+    return phys_device_features_().multiDrawIndirect;
+  }
+
+  // Enables the `*_indirect_count` draws.
+  bool supports_draw_indirect_count() const {
+    return vulkan12_features_.drawIndirectCount;
+  }
+
+  // Enables `TimelineSemaphore` and `FramePacer`.
+  bool supports_timeline_semaphore() const {
+    return vulkan12_features_.timelineSemaphore;
+  }
+
+  // Enables submitting a `SubmitBatch`.
+  bool supports_synchronization2() const {
+    return vulkan13_features_.synchronization2;
   }
 
   Buffer create_buffer(::VkDeviceSize requested_byte_count,
@@ -877,44 +2565,130 @@ class Device final {
         device_,
         requested_byte_count,
         requested_buffer_usage,
+        queue_families_,
+    };
+  }
+
+  DeviceMemory allocate_device_memory(const Buffer& buffer,
+                                      MemoryUsage usage) {
+    auto memory_type_index =
+        select_memory_type(phys_device_memory_properties_(),
+                           buffer.memory_requirements_().memoryTypeBits, usage);
+    CHECK_POSTCONDITION(memory_type_index.has_value());
+
+    return DeviceMemory{InOut(memory_allocator_->heap(*memory_type_index)),
+                        buffer.memory_requirements_(), MemoryTiling::LINEAR,
+                        buffer};
+  }
+
+  // Images are always 2D, with one sample per texel and undefined layout.
+  Image create_image(::VkFormat format,                  //
+                     ::VkExtent2D extent,                //
+                     ::VkImageUsageFlags image_usage,    //
+                     std::uint32_t mip_level_count = 1,  //
+                     std::uint32_t array_layer_count = 1,
+                     ::VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL) {
+    return Image{
+        device_,            //
+        format,             //
+        extent,             //
+        image_usage,        //
+        mip_level_count,    //
+        array_layer_count,  //
+        tiling,             //
+        queue_families_,
     };
   }
 
+  ImageView create_image_view(const Image& image) {
+    return ImageView{device_, image,
+                     image.array_layer_count() > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY
+                                                   : VK_IMAGE_VIEW_TYPE_2D,
+                     image.format(), image.subresource_range()};
+  }
+
+  DeviceMemory allocate_device_memory(const Image& image, MemoryUsage usage) {
+    auto memory_type_index =
+        select_memory_type(phys_device_memory_properties_(),
+                           image.memory_requirements_().memoryTypeBits, usage);
+    CHECK_POSTCONDITION(memory_type_index.has_value());
+
+    return DeviceMemory{InOut(memory_allocator_->heap(*memory_type_index)),
+                        image.memory_requirements_(), image.memory_tiling(),
+                        image};
+  }
+
   DeviceMemory allocate_device_memory(
       const Buffer& buffer, ::VkMemoryPropertyFlags required_memory_flags) {
-    bool found = false;
-
-    std::uint32_t memory_type_index = 0;
-    for (; memory_type_index < (sizeof(std::uint32_t) * 8) &&
-           memory_type_index < phys_device_memory_properties_().memoryTypeCount;
-         ++memory_type_index) {
-      if ((buffer.memory_requirements_().memoryTypeBits &
-           (1u << memory_type_index)) &&
-          vk::has_all_flags(phys_device_memory_properties_()
-                                .memoryTypes[memory_type_index]
-                                .propertyFlags,
-                            required_memory_flags)) {
-        found = true;
-        break;
-      }
-    }
-    CHECK_POSTCONDITION(found);
-
-    ::VkDeviceSize byte_offset = 0;
-    return DeviceMemory{device_, byte_offset,
-                        buffer.memory_requirements_().size, memory_type_index,
+    auto memory_type_index = select_memory_type(
+        phys_device_memory_properties_(),
+        buffer.memory_requirements_().memoryTypeBits,
+        MemoryTypePreference{.required = required_memory_flags});
+    CHECK_POSTCONDITION(memory_type_index.has_value());
+
+    return DeviceMemory{InOut(memory_allocator_->heap(*memory_type_index)),
+                        buffer.memory_requirements_(), MemoryTiling::LINEAR,
                         buffer};
   }
 
-  CommandBufferBlock allocate_command_buffer_block(::VkCommandPool command_pool,
-                                                   std::uint32_t count) {
-    return CommandBufferBlock{device_, command_pool, count};
+  UploadRing create_upload_ring(std::uint32_t frame_count,
+                                ::VkDeviceSize frame_byte_count,
+                                ::VkBufferUsageFlags buffer_usage) {
+    auto&& limits = phys_device_properties_().limits;
+
+    // Every frame region starts at an offset usable for any binding.
+    ::VkDeviceSize byte_alignment =
+        std::max({limits.minUniformBufferOffsetAlignment,
+                  limits.minStorageBufferOffsetAlignment,
+                  limits.minTexelBufferOffsetAlignment,
+                  ::VkDeviceSize{4}});  // Vertex/index/indirect offsets.
+    frame_byte_count = impl::align_up(frame_byte_count, byte_alignment);
+
+    auto buffer = create_buffer(frame_count * frame_byte_count, buffer_usage);
+    auto memory = allocate_device_memory(buffer, MemoryUsage::DYNAMIC);
+
+    return UploadRing{std::move(buffer),  //
+                      std::move(memory),  //
+                      frame_count,        //
+                      frame_byte_count,   //
+                      byte_alignment};
+  }
+
+  CommandBufferBlock allocate_command_buffer_block(
+      ::VkCommandPool command_pool, std::uint32_t count,
+      ::VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) {
+    return CommandBufferBlock{device_, command_pool, count, level};
+  }
+
+  CommandPool create_command_pool(std::uint32_t queue_family_index,
+                                  ::VkCommandPoolCreateFlags flags = 0) {
+    return CommandPool{device_, queue_family_index, flags};
+  }
+
+  FrameCommandRing create_frame_command_ring(
+      std::uint32_t queue_family_index, std::uint32_t frame_count,
+      std::uint32_t command_buffer_count = 1) {
+    return FrameCommandRing{device_, queue_family_index, frame_count,
+                            command_buffer_count};
   }
 
-  CommandPool create_command_pool(std::uint32_t queue_family_index) {
-    return CommandPool{device_, queue_family_index};
+  ParallelCommandRecorder create_parallel_command_recorder(
+      ThreadPool& thread_pool, std::uint32_t queue_family_index) {
+    return ParallelCommandRecorder{device_, thread_pool, queue_family_index};
   }
 
+  UploadService create_upload_service(
+      ::VkDeviceSize staging_byte_count = impl::DEFAULT_STAGING_BYTE_COUNT);
+
+  // Takes over the first queue of `kind`. Other queues for which
+  // `shares_queue(kind, ...)` holds must then not be submitted to.
+  SubmissionWorker create_submission_worker(
+      QueueKind kind = QueueKind::GRAPHICS);
+
+  // GPU frustum culling of the `CullingInstance`s in `instances`, which must
+  // be a storage buffer.
+  CullingPass create_culling_pass(const Buffer& instances);
+
   RenderPass create_render_pass(::VkFormat requested) {
     ::VkPhysicalDevice phys_device = device_.parent();
     vk::PhysicalDeviceSurfaceFormats surface_formats{phys_device, surface_};
@@ -967,12 +2741,12 @@ class Device final {
                                  requested_present_mode) !=
                        surface_present_modes().end());
 
-    return Swapchain{device_,                 //
-                     queue_families_,         //
-                     surface_,                //
-                     surface_capabilities,    //
-                     *surface_format_iter,    //
-                     requested_present_mode,  //
+    return Swapchain{device_,                    //
+                     {queue_families_.front()},  //
+                     surface_,                   //
+                     surface_capabilities,       //
+                     *surface_format_iter,       //
+                     requested_present_mode,     //
                      previous_swapchain};
   }
 
@@ -991,23 +2765,167 @@ class Device final {
     return result;
   }
 
-  PipelineLayout create_pipeline_layout() {
-    return PipelineLayout{device_};  //
+  // Seeds the cache all pipelines are created through with what was saved to
+  // `path`, provided it came from this driver and device. Otherwise keeps the
+  // current cache, which starts out empty. Returns whether it was seeded.
+  bool load_pipeline_cache(const std::filesystem::path& path) {
+    std::vector<std::byte> data = impl::read_file(path);
+    if (!impl::is_pipeline_cache_compatible(data, phys_device_properties_())) {
+      return false;
+    }
+    pipeline_cache_ = vk::PipelineCache{
+        device_, ::VkPipelineCacheCreateInfo{
+                     .initialDataSize = data.size(),
+                     .pInitialData = data.data(),
+                 }};
+    return true;
   }
 
-  GraphicsPipeline create_graphics_pipeline(::VkShaderModule vertex_shader,
-                                            ::VkShaderModule fragment_shader,
-                                            ::VkPipelineLayout pipeline_layout,
-                                            ::VkRenderPass render_pass) {
-    ::VkPhysicalDevice phys_device = device_.parent();
-    vk::PhysicalDeviceSurfaceCapabilities surface_capabilities{phys_device,
-                                                               surface_};
+  // Atomically replaces `path` with everything compiled so far, for
+  // `load_pipeline_cache` next run. Returns false on I/O failure.
+  bool save_pipeline_cache(const std::filesystem::path& path) const {
+    std::size_t byte_count = 0;
+    ::VkResult result = ::vkGetPipelineCacheData(device_, pipeline_cache_,
+                                                 &byte_count, nullptr);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+
+    std::vector<std::byte> data(byte_count);
+    result = ::vkGetPipelineCacheData(device_, pipeline_cache_, &byte_count,
+                                      data.data());
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+    data.resize(byte_count);
+
+    return impl::write_file_atomically(path, data);
+  }
+
+  PipelineLayout create_pipeline_layout(
+      std::span<const ::VkDescriptorSetLayout> set_layouts = {},
+      std::span<const ::VkPushConstantRange> push_constant_ranges = {}) {
+    return PipelineLayout{device_, set_layouts, push_constant_ranges};
+  }
+
+  ComputePipeline create_compute_pipeline(::VkShaderModule compute_shader,
+                                          ::VkPipelineLayout pipeline_layout) {
+    return ComputePipeline{device_, pipeline_cache_, compute_shader,
+                           pipeline_layout};
+  }
+
+  GraphicsPipeline create_graphics_pipeline(
+      ::VkShaderModule vertex_shader,      //
+      ::VkShaderModule fragment_shader,    //
+      ::VkPipelineLayout pipeline_layout,  //
+      ::VkRenderPass render_pass,          //
+      const GraphicsPipelineState& state = {}) {
     return GraphicsPipeline{device_,          //
+                            pipeline_cache_,  //
                             vertex_shader,    //
                             fragment_shader,  //
                             pipeline_layout,  //
                             render_pass,      //
-                            surface_capabilities().currentExtent};
+                            state};
+  }
+
+  // As above, but compiled on one of `compiler`'s threads so many pipelines
+  // build in parallel. They share the device's pipeline cache, which Vulkan
+  // synchronizes internally. Jobs hold the raw device and cache handles, so
+  // this device must outlive `compiler`, or at least every job still queued
+  // on it. The shaders, layout and render pass must live until the pipeline
+  // is ready, and the cache must not be reloaded meanwhile.
+  PendingPipeline<ComputePipeline> create_compute_pipeline_async(
+      PipelineCompiler& compiler,         //
+      ::VkShaderModule compute_shader,    //
+      ::VkPipelineLayout pipeline_layout) {
+    return PendingPipeline<ComputePipeline>{compiler.post(
+        [device = device_.handle(), cache = pipeline_cache_.handle(),
+         compute_shader, pipeline_layout] {
+          return ComputePipeline{device, cache, compute_shader,
+                                 pipeline_layout};
+        })};
+  }
+
+  PendingPipeline<GraphicsPipeline> create_graphics_pipeline_async(
+      PipelineCompiler& compiler,          //
+      ::VkShaderModule vertex_shader,      //
+      ::VkShaderModule fragment_shader,    //
+      ::VkPipelineLayout pipeline_layout,  //
+      ::VkRenderPass render_pass,          //
+      GraphicsPipelineState state = {}) {
+    return PendingPipeline<GraphicsPipeline>{compiler.post(
+        [device = device_.handle(), cache = pipeline_cache_.handle(),
+         vertex_shader, fragment_shader, pipeline_layout, render_pass,
+         state = std::move(state)] {
+          return GraphicsPipeline{device,           //
+                                  cache,            //
+                                  vertex_shader,    //
+                                  fragment_shader,  //
+                                  pipeline_layout,  //
+                                  render_pass,      //
+                                  state};
+        })};
+  }
+
+  // Equal arguments return the same layout, which the device owns.
+  ::VkPipelineLayout find_or_create_pipeline_layout(
+      std::span<const ::VkDescriptorSetLayout> set_layouts = {},
+      std::span<const ::VkPushConstantRange> push_constant_ranges = {}) {
+    PipelineLayoutKey key{
+        .set_layouts = {set_layouts.begin(), set_layouts.end()},
+        .push_constant_ranges = {push_constant_ranges.begin(),
+                                 push_constant_ranges.end()},
+    };
+    auto iter = pipeline_registry_.pipeline_layouts_.find(key);
+    if (iter == pipeline_registry_.pipeline_layouts_.end()) {
+      iter = pipeline_registry_.pipeline_layouts_
+                 .emplace(std::move(key),
+                          PipelineLayout{device_, set_layouts,
+                                         push_constant_ranges})
+                 .first;
+    }
+    return iter->second;
+  }
+
+  // As `create_graphics_pipeline`, but returns the pipeline created earlier
+  // from equal arguments for a compatible render pass, if any. The device owns
+  // it. Shaders are identified by handle, so only destroy them once no more
+  // pipelines are looked up.
+  ::VkPipeline find_or_create_graphics_pipeline(
+      ::VkShaderModule vertex_shader,      //
+      ::VkShaderModule fragment_shader,    //
+      ::VkPipelineLayout pipeline_layout,  //
+      const RenderPass& render_pass,       //
+      const GraphicsPipelineState& state = {}) {
+    GraphicsPipelineKey key{
+        .vertex_shader = vertex_shader,
+        .fragment_shader = fragment_shader,
+        .pipeline_layout = pipeline_layout,
+        .render_pass_format = render_pass.format(),
+        .state = state,
+    };
+    auto iter = pipeline_registry_.graphics_pipelines_.find(key);
+    if (iter != pipeline_registry_.graphics_pipelines_.end()) {
+      ++pipeline_registry_.hit_count_;
+      return iter->second;
+    }
+
+    ++pipeline_registry_.miss_count_;
+    GraphicsPipeline pipeline{device_,          //
+                              pipeline_cache_,  //
+                              vertex_shader,    //
+                              fragment_shader,  //
+                              pipeline_layout,  //
+                              render_pass,      //
+                              state};
+    return pipeline_registry_.graphics_pipelines_
+        .emplace(std::move(key), std::move(pipeline))
+        .first->second;
+  }
+
+  const PipelineRegistry& pipeline_registry() const {
+    return pipeline_registry_;
+  }
+
+  const DeviceMemoryAllocator& memory_allocator() const {
+    return *memory_allocator_;
   }
 
   std::vector<Semaphore> create_semaphores(std::uint32_t count) {
@@ -1018,6 +2936,35 @@ class Device final {
     return result;
   }
 
+  TimelineSemaphore create_timeline_semaphore(
+      std::uint64_t initial_value = 0) {
+    CHECK_PRECONDITION(supports_timeline_semaphore());
+    return TimelineSemaphore{device_, initial_value};
+  }
+
+  FramePacer create_frame_pacer(std::uint32_t frame_count) {
+    return FramePacer{create_timeline_semaphore(), frame_count};
+  }
+
+  // Blocks until every `semaphores[i]` reaches `values[i]`. Returns false if
+  // `timeout` passed first.
+  bool wait_for_all(
+      std::span<const ::VkSemaphore> semaphores,
+      std::span<const std::uint64_t> values,
+      std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()) {
+    return impl::wait_semaphores(device_, semaphores, values, 0, timeout);
+  }
+
+  // Blocks until any one `semaphores[i]` reaches `values[i]`. Returns false if
+  // `timeout` passed first.
+  bool wait_for_any(
+      std::span<const ::VkSemaphore> semaphores,
+      std::span<const std::uint64_t> values,
+      std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()) {
+    return impl::wait_semaphores(device_, semaphores, values,
+                                 VK_SEMAPHORE_WAIT_ANY_BIT, timeout);
+  }
+
   std::vector<Fence> create_fences(std::uint32_t count,
                                    ::VkFenceCreateFlags flags = 0) {
     std::vector<Fence> result;
@@ -1034,28 +2981,61 @@ class Device final {
       ::VkInstance instance,
       ::VkSurfaceKHR surface,                                       //
       ::VkPhysicalDevice phys_device,                               //
+      const ::VkPhysicalDeviceProperties& properties,               //
       const ::VkPhysicalDeviceFeatures& features,                   //
       const ::VkPhysicalDeviceMemoryProperties& memory_properties,  //
       std::vector<const char*> device_extensions,                   //
-      std::vector<std::uint32_t> queue_families)
-      : phys_device_features_{features},
+      impl::QueueLayout queue_layout)
+      : phys_device_properties_{properties},
+        phys_device_features_{features},
         phys_device_memory_properties_{memory_properties},
         device_extensions_{std::move(device_extensions)},
-        queue_families_{std::move(queue_families)} {
-    static const std::array<float, 1> queue_priority{1.0f};  // [0.0, 1.0]
-
-    for (auto queue_family_i : queue_families_) {
+        queue_layout_{std::move(queue_layout)} {
+    for (auto&& queue_family : queue_layout_.families) {
+      queue_families_.push_back(queue_family.family_index);
       device_queue_infos_.push_back(::VkDeviceQueueCreateInfo{
           .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO  //
       });
-      device_queue_infos_.back().queueFamilyIndex = queue_family_i;
-      device_queue_infos_.back().queueCount = queue_priority.size();
-      device_queue_infos_.back().pQueuePriorities = queue_priority.data();
+      device_queue_infos_.back().queueFamilyIndex = queue_family.family_index;
+      device_queue_infos_.back().queueCount =
+          narrow_cast<std::uint32_t>(queue_family.priorities.size());
+      device_queue_infos_.back().pQueuePriorities =
+          queue_family.priorities.data();
     }
 
+    // Core 1.2 and 1.3 features are opted into through the create info chain;
+    // enable only the ones we use, where supported. A version's structure may
+    // only be chained when the device implements that version; otherwise its
+    // features stay off.
+    bool has_vulkan12 = properties.apiVersion >= VK_API_VERSION_1_2;
+    bool has_vulkan13 = properties.apiVersion >= VK_API_VERSION_1_3;
+    ::VkPhysicalDeviceVulkan13Features supported_vulkan13_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+    };
+    ::VkPhysicalDeviceVulkan12Features supported_vulkan12_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = has_vulkan13 ? &supported_vulkan13_features : nullptr,
+    };
+    ::VkPhysicalDeviceFeatures2 supported_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = has_vulkan12 ? &supported_vulkan12_features : nullptr,
+    };
+    ::vkGetPhysicalDeviceFeatures2(phys_device, &supported_features);
+    vulkan13_features_ = ::VkPhysicalDeviceVulkan13Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .synchronization2 = supported_vulkan13_features.synchronization2,
+    };
+    vulkan12_features_ = ::VkPhysicalDeviceVulkan12Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = has_vulkan13 ? &vulkan13_features_ : nullptr,
+        .drawIndirectCount = supported_vulkan12_features.drawIndirectCount,
+        .timelineSemaphore = supported_vulkan12_features.timelineSemaphore,
+    };
+
     device_ = vk::Device{
         phys_device,
         ::VkDeviceCreateInfo{
+            .pNext = has_vulkan12 ? &vulkan12_features_ : nullptr,
             .queueCreateInfoCount =
                 narrow_cast<std::uint32_t>(device_queue_infos_.size()),
             .pQueueCreateInfos = device_queue_infos_.data(),
@@ -1065,6 +3045,12 @@ class Device final {
             .pEnabledFeatures = phys_device_features_.address(),
         }};
 
+    memory_allocator_ = std::make_unique<DeviceMemoryAllocator>(
+        device_, phys_device_memory_properties_(),
+        phys_device_properties_().limits);
+
+    pipeline_cache_ = vk::PipelineCache{device_, ::VkPipelineCacheCreateInfo{}};
+
     surface_ = vk::Surface{instance, surface};
 
     vk::PhysicalDeviceSurfaceFormats surface_formats{phys_device, surface};
@@ -1091,14 +3077,755 @@ class Device final {
   vk::Device device_;
   vk::Surface surface_;
 
+  // Declared after `device_` so blocks are freed before the device.
+  std::unique_ptr<DeviceMemoryAllocator> memory_allocator_;
+  vk::PipelineCache pipeline_cache_;  // Shared by all pipelines.
+  PipelineRegistry pipeline_registry_;
+
+  vk::PhysicalDeviceProperties phys_device_properties_;
   vk::PhysicalDeviceFeatures phys_device_features_;
   vk::PhysicalDeviceMemoryProperties phys_device_memory_properties_;
+  ::VkPhysicalDeviceVulkan12Features vulkan12_features_{};  // Enabled.
+  ::VkPhysicalDeviceVulkan13Features vulkan13_features_{};  // Enabled.
 
   std::vector<::VkDeviceQueueCreateInfo> device_queue_infos_;
   std::vector<const char*> device_extensions_;
-  std::vector<std::uint32_t> queue_families_;
+  impl::QueueLayout queue_layout_;
+  std::vector<std::uint32_t> queue_families_;  // Distinct, graphics first.
+
+  const impl::QueueRange& queue_range(QueueKind kind) const {
+    return queue_layout_.ranges[static_cast<std::size_t>(kind)];
+  }
+};
+
+//------------------------------------------------------------------------------
+struct UploadToken final {
+  std::uint64_t serial = 0;
+};
+
+// Copies host data into device-local resources through one persistently
+// mapped staging arena, on the transfer-only queue family when the device has
+// one. Each upload's staging range and command buffer are recycled by
+// `collect()` once the copy's fence has signalled; uploads that don't fit wait
+// for earlier ones to free space, and one larger than the whole arena waits
+// for all of them to replace it. The destination may only be used after
+// `wait()` or `is_complete()` reports the token done.
+class UploadService final {
+ public:
+  DECLARE_COPY_DELETE(UploadService);
+  DECLARE_MOVE_DEFAULT(UploadService);
+
+  UploadService() = delete;
+  ~UploadService() {
+    for (auto&& upload : pending_uploads_) {
+      upload.fence.wait();
+    }
+  }
+
+  std::uint32_t queue_family_index() const { return queue_.family_index(); }
+
+  ::VkDeviceSize staging_byte_count() const {
+    return staging_ranges_.capacity();
+  }
+
+  UploadToken upload(const Buffer& target,                    //
+                     std::span<const std::byte> data,         //
+                     ::VkDeviceSize target_byte_offset = 0);  //
+
+  // Fills the base mip level of every array layer from tightly packed texels,
+  // then moves the whole image into `final_layout`. A copy writes one aspect,
+  // so combined depth-stencil formats aren't supported.
+  UploadToken upload(const Image& target,               //
+                     std::span<const std::byte> data,  //
+                     ::VkImageLayout final_layout =
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  bool is_complete(UploadToken token) {
+    if (token.serial > completed_serial_) {
+      collect();
+    }
+    return token.serial <= completed_serial_;
+  }
+
+  void wait(UploadToken token) {
+    while (!pending_uploads_.empty() &&
+           pending_uploads_.front().serial <= token.serial) {
+      pending_uploads_.front().fence.wait();
+      retire_front();
+    }
+    CHECK_POSTCONDITION(token.serial <= completed_serial_);
+  }
+
+  // Recycles resources of uploads that have completed, without blocking.
+  void collect() {
+    while (!pending_uploads_.empty() &&
+           pending_uploads_.front().fence.is_signaled()) {
+      pending_uploads_.front().fence.reset();
+      retire_front();
+    }
+  }
+
+ private:
+  friend class Device;
+
+  explicit UploadService(Depend<Device> device,      //
+                         Queue queue,                //
+                         CommandPool command_pool,   //
+                         Buffer staging_buffer,      //
+                         DeviceMemory staging_memory)
+      : device_{device},
+        queue_{std::move(queue)},
+        command_pool_{std::move(command_pool)},
+        staging_buffer_{std::move(staging_buffer)},
+        staging_memory_{std::move(staging_memory)},
+        staging_ranges_{staging_buffer_.byte_count()} {
+    CHECK_PRECONDITION(staging_memory_.host_bytes().size() >=
+                       staging_buffer_.byte_count());
+  }
+
+  struct PendingUpload final {
+    std::uint64_t serial = 0;
+    ByteRange staging_range;
+    CommandBufferBlock command_buffer;
+    Fence fence;
+  };
+
+  // Only once no upload uses the current one.
+  void replace_staging_arena(::VkDeviceSize byte_count);
+
+  // Copies `data` into the staging arena, first waiting for earlier uploads
+  // to free space if needed.
+  ByteRange stage(std::span<const std::byte> data,
+                  ::VkDeviceSize byte_alignment);
+
+  // Records into a recycled one-time command buffer and submits it.
+  template <typename RecordCommands>
+  UploadToken submit(const ByteRange& staging_range,
+                     RecordCommands&& record_commands);
+
+  // Uploads on one queue complete in submission order.
+  void retire_front() {
+    auto&& upload = pending_uploads_.front();
+    completed_serial_ = upload.serial;
+    staging_ranges_.free(upload.staging_range.byte_offset,
+                         upload.staging_range.byte_count);
+    free_command_buffers_.push_back(std::move(upload.command_buffer));
+    free_fences_.push_back(std::move(upload.fence));
+    pending_uploads_.pop_front();
+  }
+
+  Depend<Device> device_;
+  Queue queue_;
+  CommandPool command_pool_;
+
+  Buffer staging_buffer_;
+  DeviceMemory staging_memory_;
+  FreeList staging_ranges_;
+
+  // Declared after `command_pool_` so command buffers are freed first.
+  std::deque<PendingUpload> pending_uploads_;
+  std::vector<CommandBufferBlock> free_command_buffers_;
+  std::vector<Fence> free_fences_;
+
+  std::uint64_t next_serial_ = 1;
+  std::uint64_t completed_serial_ = 0;
+};
+
+inline UploadService Device::create_upload_service(
+    ::VkDeviceSize staging_byte_count) {
+  auto staging_buffer =
+      create_buffer(staging_byte_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  auto staging_memory =
+      allocate_device_memory(staging_buffer, MemoryUsage::UPLOAD);
+
+  return UploadService{
+      Depend(*this),            //
+      create_transfer_queue(),  //
+      create_command_pool(transfer_queue_family_index(),
+                          VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                              VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT),
+      std::move(staging_buffer),  //
+      std::move(staging_memory)};
+}
+
+inline void UploadService::replace_staging_arena(::VkDeviceSize byte_count) {
+  CHECK_PRECONDITION(pending_uploads_.empty());
+  staging_buffer_ =
+      device_->create_buffer(byte_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  staging_memory_ =
+      device_->allocate_device_memory(staging_buffer_, MemoryUsage::UPLOAD);
+  staging_ranges_ = FreeList{byte_count};
+}
+
+inline ByteRange UploadService::stage(std::span<const std::byte> data,
+                                      ::VkDeviceSize byte_alignment) {
+  ::VkDeviceSize byte_count = data.size();
+  if (byte_count > staging_ranges_.capacity()) {
+    wait(UploadToken{next_serial_ - 1});
+    replace_staging_arena(std::bit_ceil(byte_count));
+  }
+
+  auto byte_offset = staging_ranges_.allocate(byte_count, byte_alignment);
+  while (!byte_offset) {
+    CHECK_INVARIANT(!pending_uploads_.empty());
+    wait(UploadToken{pending_uploads_.front().serial});
+    byte_offset = staging_ranges_.allocate(byte_count, byte_alignment);
+  }
+
+  std::copy(data.begin(), data.end(),
+            staging_memory_.host_bytes().begin() + *byte_offset);
+  staging_memory_.flush(*byte_offset, byte_count);
+  return ByteRange{.byte_offset = *byte_offset, .byte_count = byte_count};
+}
+
+inline UploadToken UploadService::upload(const Buffer& target,             //
+                                         std::span<const std::byte> data,  //
+                                         ::VkDeviceSize target_byte_offset) {
+  CHECK_PRECONDITION(data.size() > 0);
+  CHECK_PRECONDITION(target_byte_offset <= target.byte_count() &&
+                     data.size() <= target.byte_count() - target_byte_offset);
+
+  ByteRange staging_range = stage(data, 4);
+  return submit(staging_range, [&](::VkCommandBuffer command_buffer) {
+    ::VkBufferCopy region{
+        .srcOffset = staging_range.byte_offset,
+        .dstOffset = target_byte_offset,
+        .size = staging_range.byte_count,
+    };
+    ::vkCmdCopyBuffer(command_buffer, staging_buffer_, target, 1,
+                      std::addressof(region));
+  });
+}
+
+inline UploadToken UploadService::upload(const Image& target,              //
+                                         std::span<const std::byte> data,  //
+                                         ::VkImageLayout final_layout) {
+  CHECK_PRECONDITION(final_layout != VK_IMAGE_LAYOUT_UNDEFINED);
+  CHECK_PRECONDITION(std::has_single_bit(target.aspect_mask()));
+  std::size_t texel_byte_count = impl::format_texel_byte_count(target.format());
+  CHECK_PRECONDITION(texel_byte_count > 0);
+  // Exactly mip 0 of every layer.
+  CHECK_PRECONDITION(data.size() == texel_byte_count * target.extent().width *
+                                        target.extent().height *
+                                        target.array_layer_count());
+
+  // Copies to images need texel aligned source offsets, and multiples of 4
+  // on transfer-only queues.
+  ByteRange staging_range =
+      stage(data, std::lcm<::VkDeviceSize>(texel_byte_count, 4));
+  return submit(staging_range, [&](::VkCommandBuffer command_buffer) {
+    ::VkImageSubresourceRange range = target.subresource_range();
+
+    // Previous contents are discarded.
+    impl::record_image_layout_transition(
+        command_buffer, target, range,         //
+        VK_IMAGE_LAYOUT_UNDEFINED,             //
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,  //
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,  //
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    ::VkBufferImageCopy region{
+        .bufferOffset = staging_range.byte_offset,
+        .bufferRowLength = 0,  // Tightly packed.
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = range.aspectMask,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = range.layerCount,
+            },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {target.extent().width, target.extent().height, 1},
+    };
+    ::vkCmdCopyBufferToImage(command_buffer, staging_buffer_, target,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                             std::addressof(region));
+
+    // The transfer queue may not support the consumer's stages, so make the
+    // copy available to every later command and memory read; waiting on the
+    // upload's fence orders those after it.
+    impl::record_image_layout_transition(
+        command_buffer, target, range,                                 //
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout,            //
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,  //
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT);
+  });
+}
+
+template <typename RecordCommands>
+UploadToken UploadService::submit(const ByteRange& staging_range,
+                                  RecordCommands&& record_commands) {
+  if (free_command_buffers_.empty()) {
+    free_command_buffers_.push_back(
+        device_->allocate_command_buffer_block(command_pool_, 1));
+  }
+  if (free_fences_.empty()) {
+    free_fences_ = device_->create_fences(1);
+  }
+  auto command_buffer = std::move(free_command_buffers_.back());
+  free_command_buffers_.pop_back();
+  Fence fence = std::move(free_fences_.back());
+  free_fences_.pop_back();
+
+  {
+    // Implicitly resets a recycled command buffer.
+    vk::CommandBufferBuilder builder{
+        command_buffer[0],
+        ::VkCommandBufferBeginInfo{
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        }};
+    record_commands(command_buffer[0]);
+  }  // Ends recording.
+
+  queue_.submit(command_buffer[0], fence);
+
+  pending_uploads_.push_back(PendingUpload{
+      .serial = next_serial_++,
+      .staging_range = staging_range,
+      .command_buffer = std::move(command_buffer),
+      .fence = std::move(fence),
+  });
+  return UploadToken{pending_uploads_.back().serial};
+}
+
+//------------------------------------------------------------------------------
+struct SubmissionToken final {
+  std::uint64_t serial = 0;
+};
+
+// Work recorded elsewhere for `SubmissionWorker` to submit, then optionally
+// present once `maybe_signal_semaphore` signals.
+struct SubmissionWork final {
+  ::VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+  ::VkSemaphore maybe_wait_semaphore = VK_NULL_HANDLE;    // Binary.
+  ::VkPipelineStageFlags wait_pipeline_stages = 0;        //
+  ::VkSemaphore maybe_signal_semaphore = VK_NULL_HANDLE;  // Binary.
+  Swapchain* maybe_present_swapchain = nullptr;           //
+  std::uint32_t present_image_index = 0;                  //
+  ::VkFence maybe_signal_fence = VK_NULL_HANDLE;          //
+};
+
+namespace impl {
+constexpr std::size_t SUBMISSION_QUEUE_CAPACITY = 8;
+
+// How often `SubmissionWorker::wait` checks whether the worker failed, since
+// work it dropped will never signal.
+constexpr std::chrono::milliseconds SUBMISSION_FAILURE_POLL_INTERVAL{10};
+}  // namespace impl
+
+// Owns a queue and calls `vkQueueSubmit` and `vkQueuePresentKHR` from a
+// thread of its own, since some drivers block in them for milliseconds. Work
+// is handed over through a lock-free ring, so the recording thread only
+// blocks when the ring is full. Each submission signals the next value of
+// `timeline()`, which its token waits for; keep anything the work uses,
+// including the swapchain, alive until then. Nothing else may use the queue
+// while the worker owns it, and a swapchain it presents to must only be
+// acquired from through `acquire_next_image`. Should a submit or present
+// fail, the worker drops everything after it and rethrows the error from
+// `submit`, `is_complete` and `wait`.
+class SubmissionWorker final {
+ public:
+  DECLARE_COPY_DELETE(SubmissionWorker);
+  DECLARE_MOVE_DELETE(SubmissionWorker);  // The thread refers to `this`.
+
+  SubmissionWorker() = delete;
+
+  // Submits everything already handed over, and waits for the GPU to finish
+  // it before the timeline is destroyed.
+  ~SubmissionWorker() {
+    worker_.stop();
+    timeline_.wait(device_serial_.load());
+  }
+
+  std::uint32_t queue_family_index() const { return queue_.family_index(); }
+
+  const TimelineSemaphore& timeline() const { return timeline_; }
+
+  // Hands `work` over and returns at once, unless the ring is full. Call
+  // from one thread only.
+  SubmissionToken submit(const SubmissionWork& work) {
+    CHECK_PRECONDITION(work.command_buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(!work.maybe_present_swapchain ||
+                       work.maybe_signal_semaphore != VK_NULL_HANDLE);
+
+    SubmissionToken token{++submitted_serial_};
+    worker_.push(PendingSubmission{.work = work, .serial = token.serial});
+    return token;
+  }
+
+  // Acquires under the same lock the worker presents under, since a
+  // swapchain mustn't be used from two threads at once.
+  std::uint32_t acquire_next_image(Swapchain& swapchain,
+                                   ::VkSemaphore signal_semaphore) {
+    std::lock_guard lock{swapchain_mutex_};
+    return swapchain.acquire_next_image(signal_semaphore);
+  }
+
+  // The last present result other than `VK_SUCCESS` since the previous call,
+  // eg. `VK_ERROR_OUT_OF_DATE_KHR` once the swapchain needs recreating.
+  ::VkResult take_present_result() {
+    return present_result_.exchange(VK_SUCCESS);
+  }
+
+  // Whether the GPU has finished the work.
+  bool is_complete(SubmissionToken token) const {
+    worker_.rethrow_if_failed();
+    return timeline_.value() >= token.serial;
+  }
+
+  // Returns false if `timeout` passed before the GPU finished the work.
+  bool wait(SubmissionToken token,  //
+            std::chrono::nanoseconds timeout =
+                std::chrono::nanoseconds::max()) const {
+    while (true) {
+      worker_.rethrow_if_failed();
+      std::chrono::nanoseconds slice =
+          std::min<std::chrono::nanoseconds>(
+              timeout, impl::SUBMISSION_FAILURE_POLL_INTERVAL);
+      if (timeline_.wait(token.serial, slice)) {
+        return true;
+      }
+      if (timeout == slice) {
+        return false;
+      }
+      timeout -= slice;
+    }
+  }
+
+ private:
+  friend class Device;
+
+  explicit SubmissionWorker(Queue queue, TimelineSemaphore timeline)
+      : queue_{std::move(queue)},
+        timeline_{std::move(timeline)},
+        worker_{[this](PendingSubmission& pending) { submit_now(pending); }} {}
+
+  struct PendingSubmission final {
+    SubmissionWork work;
+    std::uint64_t serial = 0;
+  };
+
+  void submit_now(const PendingSubmission& pending) {
+    auto&& work = pending.work;
+    std::uint32_t wait_count =
+        work.maybe_wait_semaphore != VK_NULL_HANDLE ? 1 : 0;
+    std::uint32_t signal_count =
+        work.maybe_signal_semaphore != VK_NULL_HANDLE ? 2 : 1;
+
+    std::array<::VkSemaphore, 1> wait_semaphores{work.maybe_wait_semaphore};
+    std::array<std::uint64_t, 1> wait_values{0};
+    std::array<::VkPipelineStageFlags, 1> wait_pipeline_stages{
+        work.wait_pipeline_stages};
+    std::array<::VkSemaphore, 2> signal_semaphores{
+        timeline_, work.maybe_signal_semaphore};
+    std::array<std::uint64_t, 2> signal_values{pending.serial, 0};
+
+    queue_.submit(work.command_buffer,                                //
+                  std::span{wait_semaphores}.first(wait_count),       //
+                  std::span{wait_values}.first(wait_count),           //
+                  std::span{wait_pipeline_stages}.first(wait_count),  //
+                  std::span{signal_semaphores}.first(signal_count),   //
+                  std::span{signal_values}.first(signal_count),       //
+                  work.maybe_signal_fence);
+    device_serial_.store(pending.serial);
+
+    if (work.maybe_present_swapchain) {
+      std::lock_guard lock{swapchain_mutex_};
+      ::VkResult result = work.maybe_present_swapchain->present(
+          work.present_image_index, queue_, work.maybe_signal_semaphore);
+      if (result != VK_SUCCESS) {
+        present_result_.store(result);
+      }
+    }
+  }
+
+  Queue queue_;
+  TimelineSemaphore timeline_;
+  std::uint64_t submitted_serial_ = 0;           // Producer only.
+  std::atomic<std::uint64_t> device_serial_ = 0;  // Last sent to the queue.
+  std::mutex swapchain_mutex_;
+  std::atomic<::VkResult> present_result_ = VK_SUCCESS;
+
+  // Declared last so the thread stops before the state above is destroyed.
+  SpscWorker<PendingSubmission, impl::SUBMISSION_QUEUE_CAPACITY> worker_;
+};
+
+inline SubmissionWorker Device::create_submission_worker(QueueKind kind) {
+  return SubmissionWorker{create_queue(kind), create_timeline_semaphore()};
+}
+
+//------------------------------------------------------------------------------
+// Instance record read by `CullingPass`; matches `Instance` in
+// shaders/cull_instances.comp.
+struct CullingInstance final {
+  std::array<float, 4> bounding_sphere{};  // Center xyz, radius w.
+  std::uint32_t index_count = 0;
+  std::uint32_t first_index = 0;
+  std::int32_t vertex_offset = 0;
+  std::uint32_t reserved = 0;
+};
+static_assert(sizeof(CullingInstance) == 32);
+
+// Inward facing, normalized planes (xyz normal, w offset): left, right,
+// bottom, top, near, far.
+using FrustumPlanes = std::array<std::array<float, 4>, 6>;
+
+// Extracts the planes of a column-major view-projection matrix with depth in
+// [0, 1], as used by Vulkan.
+inline FrustumPlanes frustum_planes(const std::array<float, 16>& matrix) {
+  auto row = [&](std::size_t i) {
+    return std::array<float, 4>{matrix[i], matrix[4 + i], matrix[8 + i],
+                                matrix[12 + i]};
+  };
+  auto add = [](std::array<float, 4> a, std::array<float, 4> b, float sign) {
+    return std::array<float, 4>{a[0] + sign * b[0], a[1] + sign * b[1],
+                                a[2] + sign * b[2], a[3] + sign * b[3]};
+  };
+
+  FrustumPlanes planes{
+      add(row(3), row(0), +1.f), add(row(3), row(0), -1.f),
+      add(row(3), row(1), +1.f), add(row(3), row(1), -1.f),
+      row(2),                    add(row(3), row(2), -1.f),
+  };
+  for (auto&& plane : planes) {
+    float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] +
+                             plane[2] * plane[2]);
+    CHECK_INVARIANT(length > 0.f);
+    for (auto&& component : plane) {
+      component /= length;
+    }
+  }
+  return planes;
+}
+
+// Host reference of the test in shaders/cull_instances.comp.
+inline bool is_sphere_in_frustum(const FrustumPlanes& planes,
+                                 const std::array<float, 4>& sphere) {
+  return std::all_of(planes.begin(), planes.end(), [&](auto&& plane) {
+    return plane[0] * sphere[0] + plane[1] * sphere[1] +
+               plane[2] * sphere[2] + plane[3] >=
+           -sphere[3];
+  });
+}
+
+//------------------------------------------------------------------------------
+// Culls instances against the view frustum on the GPU and compacts the
+// survivors into indexed indirect draws plus a draw count, so that thousands
+// of objects are drawn by one `draw_indexed_indirect_count`. Each survivor's
+// draw has its instance index as `firstInstance`.
+class CullingPass final {
+ public:
+  DECLARE_COPY_DELETE(CullingPass);
+  DECLARE_MOVE_DEFAULT(CullingPass);
+
+  CullingPass() = delete;
+  ~CullingPass() = default;
+
+  std::uint32_t max_instance_count() const { return max_instance_count_; }
+
+  const Buffer& draw_commands() const { return draw_commands_; }
+  const Buffer& draw_count() const { return draw_count_; }
+
+  // Records the culling dispatch and the barriers that make its output
+  // visible to indirect draws later in the queue.
+  void record(ComputeCommandBuilder& builder,  //
+              const FrustumPlanes& planes,     //
+              std::uint32_t instance_count) const {
+    CHECK_PRECONDITION(instance_count <= max_instance_count_);
+
+    // Earlier frames may still be drawing from the output.
+    builder.barrier(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT |
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0);
+    builder.fill(draw_count_, 0, sizeof(std::uint32_t), 0);
+    builder.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    PushConstants push_constants{
+        .planes = planes,
+        .instance_count = instance_count,
+    };
+    builder.bind(pipeline_);
+    builder.bind(pipeline_layout_, 0, std::span{&descriptor_set_, 1});
+    builder.push_constants(pipeline_layout_, push_constants);
+    builder.dispatch((instance_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE);
+
+    builder.barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                    VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+  }
+
+  // Draws the survivors of the last `record` with the currently bound
+  // pipeline and index buffer.
+  template <typename DrawCommandBuilderType>
+  void draw(DrawCommandBuilderType& builder) const {
+    builder.draw_indexed_indirect_count(draw_commands_, 0, draw_count_, 0,
+                                        max_instance_count_);
+  }
+
+ private:
+  friend class Device;
+
+  static constexpr std::uint32_t WORKGROUP_SIZE = 64;  // `local_size_x`.
+  static constexpr std::uint32_t BINDING_COUNT = 3;
+
+  // Matches `Culling` in shaders/cull_instances.comp.
+  struct PushConstants final {
+    FrustumPlanes planes;
+    std::uint32_t instance_count = 0;
+  };
+
+  static constexpr ::VkPushConstantRange PUSH_CONSTANT_RANGE{
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .offset = 0,
+      .size = sizeof(PushConstants),
+  };
+
+  // Instances, draw commands and draw count, in binding order.
+  static vk::DescriptorSetLayout create_descriptor_set_layout(
+      ::VkDevice device) {
+    std::array<::VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings;
+    for (std::uint32_t i = 0; i < bindings.size(); ++i) {
+      bindings[i] = ::VkDescriptorSetLayoutBinding{
+          .binding = i,
+          .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .descriptorCount = 1,
+          .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      };
+    }
+    return vk::DescriptorSetLayout{
+        device, ::VkDescriptorSetLayoutCreateInfo{
+                    .bindingCount = narrow_cast<std::uint32_t>(bindings.size()),
+                    .pBindings = bindings.data(),
+                }};
+  }
+
+  explicit CullingPass(::VkDevice device,                              //
+                       ::VkBuffer instances,                           //
+                       std::uint32_t max_instance_count,               //
+                       Buffer draw_commands,                           //
+                       DeviceMemory draw_commands_memory,              //
+                       Buffer draw_count,                              //
+                       DeviceMemory draw_count_memory,                 //
+                       vk::DescriptorSetLayout descriptor_set_layout,  //
+                       PipelineLayout pipeline_layout,                 //
+                       ComputePipeline pipeline)
+      : max_instance_count_{max_instance_count},
+        draw_commands_{std::move(draw_commands)},
+        draw_commands_memory_{std::move(draw_commands_memory)},
+        draw_count_{std::move(draw_count)},
+        draw_count_memory_{std::move(draw_count_memory)},
+        descriptor_set_layout_{std::move(descriptor_set_layout)},
+        pipeline_layout_{std::move(pipeline_layout)},
+        pipeline_{std::move(pipeline)} {
+    ::VkDescriptorPoolSize pool_size{
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = BINDING_COUNT,
+    };
+    descriptor_pool_ = vk::DescriptorPool{
+        device, ::VkDescriptorPoolCreateInfo{
+                    .maxSets = 1,
+                    .poolSizeCount = 1,
+                    .pPoolSizes = &pool_size,
+                }};
+
+    ::VkDescriptorSetLayout set_layout = descriptor_set_layout_.handle();
+    ::VkDescriptorSetAllocateInfo allocate_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptor_pool_.handle(),
+        .descriptorSetCount = 1,
+        .pSetLayouts = &set_layout,
+    };
+    ::VkResult result =
+        ::vkAllocateDescriptorSets(device, &allocate_info, &descriptor_set_);
+    CHECK_POSTCONDITION(result == VK_SUCCESS);
+
+    std::array<::VkDescriptorBufferInfo, BINDING_COUNT> buffer_infos{
+        ::VkDescriptorBufferInfo{.buffer = instances, .range = VK_WHOLE_SIZE},
+        ::VkDescriptorBufferInfo{.buffer = draw_commands_,
+                                 .range = VK_WHOLE_SIZE},
+        ::VkDescriptorBufferInfo{.buffer = draw_count_,
+                                 .range = VK_WHOLE_SIZE},
+    };
+    std::array<::VkWriteDescriptorSet, BINDING_COUNT> writes;
+    for (std::uint32_t i = 0; i < writes.size(); ++i) {
+      writes[i] = ::VkWriteDescriptorSet{
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .dstSet = descriptor_set_,
+          .dstBinding = i,
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .pBufferInfo = &buffer_infos[i],
+      };
+    }
+    ::vkUpdateDescriptorSets(device, narrow_cast<std::uint32_t>(writes.size()),
+                             writes.data(), 0, nullptr);
+  }
+
+  std::uint32_t max_instance_count_ = 0;
+  Buffer draw_commands_;
+  DeviceMemory draw_commands_memory_;
+  Buffer draw_count_;
+  DeviceMemory draw_count_memory_;
+
+  vk::DescriptorSetLayout descriptor_set_layout_;
+  PipelineLayout pipeline_layout_;
+  ComputePipeline pipeline_;
+  vk::DescriptorPool descriptor_pool_;  // Owns `descriptor_set_`.
+  ::VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
 };
 
+inline CullingPass Device::create_culling_pass(const Buffer& instances) {
+  CHECK_PRECONDITION(supports_draw_indirect_count());
+  CHECK_PRECONDITION(instances.usage() & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  auto max_instance_count = narrow_cast<std::uint32_t>(
+      instances.byte_count() / sizeof(CullingInstance));
+  CHECK_PRECONDITION(max_instance_count > 0);
+
+  // Both outputs can be copied out, eg. to check them on the host.
+  auto draw_commands = create_buffer(
+      max_instance_count * sizeof(::VkDrawIndexedIndirectCommand),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  auto draw_commands_memory =
+      allocate_device_memory(draw_commands, MemoryUsage::GPU_ONLY);
+  auto draw_count = create_buffer(sizeof(std::uint32_t),
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  auto draw_count_memory =
+      allocate_device_memory(draw_count, MemoryUsage::GPU_ONLY);
+
+  auto descriptor_set_layout =
+      CullingPass::create_descriptor_set_layout(device_);
+  ::VkDescriptorSetLayout set_layout = descriptor_set_layout.handle();
+  auto pipeline_layout = create_pipeline_layout(
+      std::span{&set_layout, 1},
+      std::span{&CullingPass::PUSH_CONSTANT_RANGE, 1});
+  // Only needed until the pipeline is created.
+  auto compute_shader =
+      create_shader_module(cull_instances_compute_shader_spirv_bin);
+  auto pipeline = create_compute_pipeline(compute_shader, pipeline_layout);
+
+  return CullingPass{device_,                           //
+                     instances,                         //
+                     max_instance_count,                //
+                     std::move(draw_commands),          //
+                     std::move(draw_commands_memory),   //
+                     std::move(draw_count),             //
+                     std::move(draw_count_memory),      //
+                     std::move(descriptor_set_layout),  //
+                     std::move(pipeline_layout),        //
+                     std::move(pipeline)};
+}
+
 //------------------------------------------------------------------------------
 class Instance final {
  public:
@@ -1110,7 +3837,8 @@ class Instance final {
 
   operator ::VkInstance() const { return instance_.handle(); }
 
-  Device create_presentation_device(::VkSurfaceKHR surface) {
+  Device create_presentation_device(
+      ::VkSurfaceKHR surface, const DeviceQueueRequest& queue_request = {}) {
     CHECK_PRECONDITION(surface != VK_NULL_HANDLE);
 
     std::vector<FindQueueFamilyResult> selected_result = select_queue_family_if(
@@ -1139,13 +3867,18 @@ class Instance final {
     std::uint32_t selected_queue_family_index =
         selected_result.front().queue_family_index;
 
+    impl::QueueLayout queue_layout = impl::select_queue_layout(
+        phys_device_queue_family_properties_[selected_phys_device](),
+        selected_queue_family_index, queue_request);
+
     return Device{instance_,
                   surface,
                   selected_phys_device,
+                  phys_device_properties_[selected_phys_device],
                   phys_device_features_[selected_phys_device],
                   phys_device_memory_properties_[selected_phys_device],
                   {impl::SWAPCHAIN_EXTENSION_NAME},
-                  {selected_queue_family_index}};
+                  std::move(queue_layout)};
   }
 
  private:
@@ -6,9 +6,301 @@ namespace volcano {
 
 TEST_CASE("Application") {
   Application application{"test-app", 0};
-  auto instance = application.CreateInstance();
+  auto instance = application.create_instance();
 
   SECTION("ShouldPass") { REQUIRE(true); }
 }
 
+TEST_CASE("FormatAspectMask") {
+  SECTION("ShouldSelectColorByDefault") {
+    REQUIRE(impl::format_aspect_mask(VK_FORMAT_B8G8R8A8_UNORM) ==
+            VK_IMAGE_ASPECT_COLOR_BIT);
+  }
+
+  SECTION("ShouldSelectDepthAndStencil") {
+    REQUIRE(impl::format_aspect_mask(VK_FORMAT_D32_SFLOAT) ==
+            VK_IMAGE_ASPECT_DEPTH_BIT);
+    REQUIRE(impl::format_aspect_mask(VK_FORMAT_D24_UNORM_S8_UINT) ==
+            (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT));
+  }
+}
+
+TEST_CASE("FormatTexelByteCount") {
+  SECTION("ShouldSizeSingleAspectFormats") {
+    REQUIRE(impl::format_texel_byte_count(VK_FORMAT_R8G8B8A8_SRGB) == 4);
+    REQUIRE(impl::format_texel_byte_count(VK_FORMAT_D16_UNORM) == 2);
+    REQUIRE(impl::format_texel_byte_count(VK_FORMAT_R32G32B32A32_SFLOAT) ==
+            16);
+  }
+
+  SECTION("ShouldNotSizeCombinedDepthStencil") {
+    REQUIRE(impl::format_texel_byte_count(VK_FORMAT_D24_UNORM_S8_UINT) == 0);
+  }
+}
+
+TEST_CASE("IndirectByteCount") {
+  SECTION("ShouldReadNothingForZeroDraws") {
+    REQUIRE(impl::indirect_byte_count(0, 64, 16) == 0);
+  }
+
+  SECTION("ShouldReadOneCommandPastTheLastStride") {
+    REQUIRE(impl::indirect_byte_count(1, 64, 16) == 16);
+    REQUIRE(impl::indirect_byte_count(3, 64, 16) == 2 * 64 + 16);
+  }
+}
+
+TEST_CASE("IndexBufferOffset") {
+  SECTION("ShouldAcceptOffsetsAlignedToIndexSize") {
+    REQUIRE(vk::impl::is_valid_index_buffer_offset(6, VK_INDEX_TYPE_UINT16));
+    REQUIRE(vk::impl::is_valid_index_buffer_offset(8, VK_INDEX_TYPE_UINT32));
+  }
+
+  SECTION("ShouldRejectOffsetsSplittingAnIndex") {
+    REQUIRE_FALSE(
+        vk::impl::is_valid_index_buffer_offset(3, VK_INDEX_TYPE_UINT16));
+    REQUIRE_FALSE(
+        vk::impl::is_valid_index_buffer_offset(6, VK_INDEX_TYPE_UINT32));
+  }
+}
+
+TEST_CASE("QueueLayout") {
+  constexpr ::VkQueueFlags ALL_QUEUES =
+      VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+
+  SECTION("ShouldPreferDedicatedFamilies") {
+    // Precondition.
+    std::array<::VkQueueFamilyProperties, 3> properties{{
+        {.queueFlags = ALL_QUEUES, .queueCount = 16},
+        {.queueFlags = VK_QUEUE_TRANSFER_BIT, .queueCount = 2},
+        {.queueFlags = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT,
+         .queueCount = 8},
+    }};
+
+    // Under Test.
+    auto layout = impl::select_queue_layout(
+        properties, 0, {.compute_priorities = {1.0f, 0.5f}});
+
+    // Postcondition.
+    REQUIRE(layout.families.size() == 3);
+    REQUIRE(layout.families[0].family_index == 0);
+    REQUIRE(layout.ranges[1].family_index == 2);
+    REQUIRE(layout.ranges[1].queue_count == 2);
+    REQUIRE(layout.ranges[2].family_index == 1);
+    REQUIRE(layout.ranges[2].first_queue_index == 0);
+  }
+
+  SECTION("ShouldTakeTheNextQueuesOfASharedFamily") {
+    // Precondition.
+    std::array<::VkQueueFamilyProperties, 1> properties{{
+        {.queueFlags = ALL_QUEUES, .queueCount = 4},
+    }};
+
+    // Under Test.
+    auto layout = impl::select_queue_layout(
+        properties, 0, {.compute_priorities = {1.0f, 0.5f}});
+
+    // Postcondition.
+    REQUIRE(layout.families.size() == 1);
+    REQUIRE(layout.families[0].priorities ==
+            std::vector<float>{1.0f, 1.0f, 0.5f, 1.0f});
+    REQUIRE(layout.ranges[1].first_queue_index == 1);
+    REQUIRE(layout.ranges[1].queue_count == 2);
+    REQUIRE(layout.ranges[2].first_queue_index == 3);
+  }
+
+  SECTION("ShouldShareTheLastQueueOnceAFamilyRunsOut") {
+    // Precondition.
+    std::array<::VkQueueFamilyProperties, 1> properties{{
+        {.queueFlags = ALL_QUEUES, .queueCount = 1},
+    }};
+
+    // Under Test.
+    auto layout = impl::select_queue_layout(properties, 0, {});
+
+    // Postcondition.
+    REQUIRE(layout.families[0].priorities.size() == 1);
+    REQUIRE(layout.ranges[1].first_queue_index == 0);
+    REQUIRE(layout.ranges[2].first_queue_index == 0);
+    REQUIRE(layout.ranges[2].queue_count == 1);
+  }
+
+  SECTION("ShouldReportQueuesSharedBetweenKinds") {
+    // Precondition.
+    std::array<::VkQueueFamilyProperties, 1> properties{{
+        {.queueFlags = ALL_QUEUES, .queueCount = 2},
+    }};
+
+    // Under Test.
+    auto layout = impl::select_queue_layout(properties, 0, {});
+
+    // Postcondition.
+    REQUIRE_FALSE(impl::is_overlapping(layout.ranges[0], layout.ranges[1]));
+    REQUIRE(impl::is_overlapping(layout.ranges[1], layout.ranges[2]));
+    REQUIRE(impl::is_overlapping(layout.ranges[2], layout.ranges[2]));
+  }
+}
+
+TEST_CASE("SubmitBatch") {
+  SubmitBatch batch;
+  auto semaphore = reinterpret_cast<::VkSemaphore>(0x1);
+  auto command_buffers = std::array{reinterpret_cast<::VkCommandBuffer>(0x2),
+                                    reinterpret_cast<::VkCommandBuffer>(0x3),
+                                    reinterpret_cast<::VkCommandBuffer>(0x4)};
+
+  SECTION("ShouldGroupEntriesBySubmission") {
+    // Under Test.
+    batch.wait(semaphore, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
+        .execute(command_buffers[0])
+        .execute(command_buffers[1])
+        .next()
+        .execute(command_buffers[2])
+        .signal(semaphore, 7);
+    auto submit_infos = batch.submit_infos();
+
+    // Postcondition.
+    REQUIRE(submit_infos.size() == 2);
+    REQUIRE(submit_infos[0].waitSemaphoreInfoCount == 1);
+    REQUIRE(submit_infos[0].commandBufferInfoCount == 2);
+    REQUIRE(submit_infos[0].signalSemaphoreInfoCount == 0);
+    REQUIRE(submit_infos[1].waitSemaphoreInfoCount == 0);
+    REQUIRE(submit_infos[1].pCommandBufferInfos[0].commandBuffer ==
+            command_buffers[2]);
+    REQUIRE(submit_infos[1].pSignalSemaphoreInfos[0].value == 7);
+  }
+
+  SECTION("ShouldReuseStorageAfterClear") {
+    // Precondition.
+    batch.execute(command_buffers[0]);
+    auto* command_buffer_infos = batch.submit_infos()[0].pCommandBufferInfos;
+
+    // Under Test.
+    batch.clear();
+    REQUIRE(batch.empty());
+    batch.execute(command_buffers[1]);
+
+    // Postcondition.
+    auto submit_infos = batch.submit_infos();
+    REQUIRE(submit_infos.size() == 1);
+    REQUIRE(submit_infos[0].commandBufferInfoCount == 1);
+    REQUIRE(submit_infos[0].pCommandBufferInfos == command_buffer_infos);
+    REQUIRE(command_buffer_infos[0].commandBuffer == command_buffers[1]);
+  }
+}
+
+TEST_CASE("PipelineCacheFile") {
+  ::VkPhysicalDeviceProperties properties{
+      .vendorID = 0x10de,
+      .deviceID = 0x2684,
+      .pipelineCacheUUID = {1, 2, 3, 4},
+  };
+  ::VkPipelineCacheHeaderVersionOne header{
+      .headerSize = sizeof(::VkPipelineCacheHeaderVersionOne),
+      .headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE,
+      .vendorID = 0x10de,
+      .deviceID = 0x2684,
+      .pipelineCacheUUID = {1, 2, 3, 4},
+  };
+  std::vector<std::byte> data(sizeof(header) + 8);
+
+  SECTION("ShouldAcceptMatchingHeader") {
+    std::memcpy(data.data(), &header, sizeof(header));
+    REQUIRE(impl::is_pipeline_cache_compatible(data, properties));
+    REQUIRE_FALSE(impl::is_pipeline_cache_compatible(
+        std::span{data}.first(sizeof(header) - 1), properties));
+  }
+
+  SECTION("ShouldRejectOtherDevice") {
+    header.deviceID = 0x2685;
+    std::memcpy(data.data(), &header, sizeof(header));
+    REQUIRE_FALSE(impl::is_pipeline_cache_compatible(data, properties));
+  }
+
+  SECTION("ShouldRejectOtherDriverBuild") {
+    header.pipelineCacheUUID[0] = 9;
+    std::memcpy(data.data(), &header, sizeof(header));
+    REQUIRE_FALSE(impl::is_pipeline_cache_compatible(data, properties));
+  }
+
+  SECTION("ShouldRoundTripThroughFile") {
+    // Precondition.
+    std::memcpy(data.data(), &header, sizeof(header));
+    auto path = std::filesystem::temp_directory_path() /
+                "volcano_resource_test.pipeline_cache";
+    std::filesystem::remove(path);
+    REQUIRE(impl::read_file(path).empty());
+
+    // Under Test.
+    REQUIRE(impl::write_file_atomically(path, data));
+
+    // Postcondition.
+    REQUIRE(impl::read_file(path) == data);
+    REQUIRE_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    std::filesystem::remove(path);
+  }
+}
+
+TEST_CASE("GraphicsPipelineKey") {
+  GraphicsPipelineKey key{
+      .vertex_shader = reinterpret_cast<::VkShaderModule>(0x1),
+      .fragment_shader = reinterpret_cast<::VkShaderModule>(0x2),
+      .pipeline_layout = reinterpret_cast<::VkPipelineLayout>(0x3),
+      .render_pass_format = VK_FORMAT_B8G8R8A8_UNORM,
+  };
+  GraphicsPipelineKey other = key;
+  GraphicsPipelineKeyHash hash;
+
+  SECTION("ShouldMatchEqualState") {
+    REQUIRE(key == other);
+    REQUIRE(hash(key) == hash(other));
+  }
+
+  SECTION("ShouldDistinguishFixedFunctionState") {
+    // Under Test.
+    other.state.color_blend.blendEnable = VK_TRUE;
+
+    // Postcondition.
+    REQUIRE_FALSE(key == other);
+    REQUIRE(hash(key) != hash(other));
+  }
+
+  SECTION("ShouldDistinguishVertexLayout") {
+    // Under Test.
+    other.state.vertex_attributes.pop_back();
+
+    // Postcondition.
+    REQUIRE_FALSE(key == other);
+    REQUIRE(hash(key) != hash(other));
+  }
+}
+
+TEST_CASE("FrustumPlanes") {
+  // Identity view-projection: the clip volume x, y in [-1, 1], z in [0, 1].
+  std::array<float, 16> identity{1.f, 0.f, 0.f, 0.f,  //
+                                 0.f, 1.f, 0.f, 0.f,  //
+                                 0.f, 0.f, 1.f, 0.f,  //
+                                 0.f, 0.f, 0.f, 1.f};
+  auto planes = frustum_planes(identity);
+
+  SECTION("ShouldExtractInwardPlanes") {
+    REQUIRE(planes[0] == std::array<float, 4>{1.f, 0.f, 0.f, 1.f});
+    REQUIRE(planes[1] == std::array<float, 4>{-1.f, 0.f, 0.f, 1.f});
+    REQUIRE(planes[4] == std::array<float, 4>{0.f, 0.f, 1.f, 0.f});
+    REQUIRE(planes[5] == std::array<float, 4>{0.f, 0.f, -1.f, 1.f});
+  }
+
+  SECTION("ShouldKeepSpheresInside") {
+    REQUIRE(is_sphere_in_frustum(planes, {0.f, 0.f, 0.5f, 0.1f}));
+  }
+
+  SECTION("ShouldKeepSpheresStraddlingAPlane") {
+    REQUIRE(is_sphere_in_frustum(planes, {1.5f, 0.f, 0.5f, 1.f}));
+    REQUIRE(is_sphere_in_frustum(planes, {0.f, 0.f, -0.5f, 1.f}));
+  }
+
+  SECTION("ShouldCullSpheresOutside") {
+    REQUIRE_FALSE(is_sphere_in_frustum(planes, {3.f, 0.f, 0.5f, 1.f}));
+    REQUIRE_FALSE(is_sphere_in_frustum(planes, {0.f, 0.f, 2.5f, 1.f}));
+  }
+}
+
 }  // namespace volcano
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "lib/base.hpp"
+
+namespace volcano {
+
+//------------------------------------------------------------------------------
+// Defers destruction of resources until the GPU work that last used them has
+// completed, instead of idling the whole device. Resources are keyed by a
+// monotonic serial (eg. frame number or timeline semaphore value) and
+// destroyed by `collect()` once that serial is known to be complete.
+//
+// Anything left when the queue is cleared or destroyed is destroyed
+// immediately; the caller must have waited for the device by then.
+class RetireQueue final {
+ public:
+  DECLARE_COPY_DELETE(RetireQueue);
+  DECLARE_MOVE_DEFAULT(RetireQueue);
+
+  RetireQueue() = default;
+  ~RetireQueue() = default;
+
+  std::size_t size() const { return retired_.size(); }
+  bool empty() const { return retired_.empty(); }
+
+  // Takes ownership of `resource` until `serial` completes.
+  template <typename ResourceType>
+    requires(!std::is_lvalue_reference_v<ResourceType>)
+  void retire(ResourceType&& resource, std::uint64_t serial) {
+    CHECK_PRECONDITION(retired_.empty() || retired_.back().serial <= serial);
+    Retired retired{
+        .serial = serial,
+        .resource = {new ResourceType(std::move(resource)),
+                     [](void* resource) {
+                       delete static_cast<ResourceType*>(resource);
+                     }},
+    };
+    retired_.push_back(std::move(retired));
+  }
+
+  // Destroys up to `max_count` resources whose serial is at most
+  // `completed_serial`, oldest first. Returns the number destroyed.
+  std::size_t collect(
+      std::uint64_t completed_serial,
+      std::size_t max_count = std::numeric_limits<std::size_t>::max()) {
+    std::size_t count = 0;
+    while (count < max_count && !retired_.empty() &&
+           retired_.front().serial <= completed_serial) {
+      retired_.pop_front();
+      ++count;
+    }
+    return count;
+  }
+
+  void clear() { retired_.clear(); }
+
+ private:
+  struct Retired final {
+    std::uint64_t serial = 0;
+    std::unique_ptr<void, void (*)(void*)> resource;
+  };
+
+  std::deque<Retired> retired_;
+};
+
+}  // namespace volcano
@@ -0,0 +1,101 @@
+#include "lib/retire_queue.hpp"
+
+#include <vector>
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+namespace {
+// Records its own destruction.
+class Tracked final {
+ public:
+  DECLARE_COPY_DELETE(Tracked);
+
+  Tracked(int id, InOut<std::vector<int>> destroyed)
+      : id_{id}, destroyed_{destroyed.get()} {}
+
+  Tracked(Tracked&& that) noexcept
+      : id_{that.id_}, destroyed_{std::exchange(that.destroyed_, nullptr)} {}
+
+  Tracked& operator=(Tracked&& that) = delete;
+
+  ~Tracked() {
+    if (destroyed_) {
+      destroyed_->push_back(id_);
+    }
+  }
+
+ private:
+  int id_ = 0;
+  std::vector<int>* destroyed_ = nullptr;
+};
+}  // namespace
+
+TEST_CASE("RetireQueue") {
+  std::vector<int> destroyed;
+  RetireQueue retire_queue;
+
+  SECTION("ShouldHoldUntilSerialCompletes") {
+    // Precondition.
+    retire_queue.retire(Tracked{1, InOut(destroyed)}, 5);
+    REQUIRE(destroyed.empty());
+
+    // Under Test.
+    retire_queue.collect(4);
+
+    // Postcondition.
+    REQUIRE(destroyed.empty());
+    REQUIRE(retire_queue.size() == 1);
+  }
+
+  SECTION("ShouldDestroyInRetirementOrder") {
+    // Precondition.
+    retire_queue.retire(Tracked{1, InOut(destroyed)}, 1);
+    retire_queue.retire(Tracked{2, InOut(destroyed)}, 2);
+    retire_queue.retire(Tracked{3, InOut(destroyed)}, 3);
+
+    // Under Test.
+    auto count = retire_queue.collect(2);
+
+    // Postcondition.
+    REQUIRE(count == 2);
+    REQUIRE(destroyed == std::vector<int>{1, 2});
+    REQUIRE(retire_queue.size() == 1);
+  }
+
+  SECTION("ShouldAmortizeAcrossCollections") {
+    // Precondition.
+    retire_queue.retire(Tracked{1, InOut(destroyed)}, 1);
+    retire_queue.retire(Tracked{2, InOut(destroyed)}, 1);
+
+    // Under Test.
+    auto count = retire_queue.collect(1, 1);
+
+    // Postcondition.
+    REQUIRE(count == 1);
+    REQUIRE(destroyed == std::vector<int>{1});
+  }
+
+  SECTION("ShouldDestroyRemainingOnClear") {
+    // Precondition.
+    retire_queue.retire(Tracked{1, InOut(destroyed)}, 10);
+
+    // Under Test.
+    retire_queue.clear();
+
+    // Postcondition.
+    REQUIRE(destroyed == std::vector<int>{1});
+    REQUIRE(retire_queue.empty());
+  }
+
+  SECTION("ShouldRejectDecreasingSerial") {
+    // Precondition.
+    retire_queue.retire(Tracked{1, InOut(destroyed)}, 2);
+
+    // Postcondition.
+    REQUIRE_THROWS_AS(retire_queue.retire(Tracked{2, InOut(destroyed)}, 1),
+                      std::logic_error);
+  }
+}
+
+}  // namespace volcano
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "lib/base.hpp"
+
+namespace volcano {
+
+namespace impl {
+constexpr std::size_t CACHE_LINE_BYTE_COUNT = 64;
+}  // namespace impl
+
+//------------------------------------------------------------------------------
+// Bounded lock-free queue handing values from exactly one producer thread to
+// exactly one consumer thread. Neither side blocks: `try_push` fails when full
+// and `try_pop` when empty, leaving the waiting strategy to the caller.
+template <typename ValueType, std::size_t Capacity>
+class SpscQueue final {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+ public:
+  DECLARE_COPY_DELETE(SpscQueue);
+  DECLARE_MOVE_DELETE(SpscQueue);
+
+  SpscQueue() = default;
+  ~SpscQueue() = default;
+
+  static constexpr std::size_t capacity() { return Capacity; }
+
+  // Producer only.
+  bool try_push(ValueType value) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    slots_[tail % Capacity] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only.
+  std::optional<ValueType> try_pop() {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    std::optional<ValueType> value{std::move(slots_[head % Capacity])};
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  // Exact only while neither side is running.
+  std::size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  // Each index on its own cache line so the two sides don't contend.
+  alignas(impl::CACHE_LINE_BYTE_COUNT) std::atomic<std::size_t> head_ = 0;
+  alignas(impl::CACHE_LINE_BYTE_COUNT) std::atomic<std::size_t> tail_ = 0;
+  alignas(impl::CACHE_LINE_BYTE_COUNT) std::array<ValueType, Capacity> slots_{};
+};
+
+//------------------------------------------------------------------------------
+// Drains an `SpscQueue` on a thread of its own, calling `consume` on each value
+// in push order. The producer only blocks while the queue is full. Should
+// `consume` throw, the worker keeps the first exception, drops everything
+// after it, and rethrows it to the producer from `push` and
+// `rethrow_if_failed`.
+template <typename ValueType, std::size_t Capacity>
+class SpscWorker final {
+ public:
+  DECLARE_COPY_DELETE(SpscWorker);
+  DECLARE_MOVE_DELETE(SpscWorker);  // The thread refers to `this`.
+
+  SpscWorker() = delete;
+
+  explicit SpscWorker(std::move_only_function<void(ValueType&)> consume)
+      : consume_{std::move(consume)}, thread_{[this] { run(); }} {}
+
+  ~SpscWorker() { stop(); }
+
+  // Consumes everything already pushed, then ends the thread. Producer only;
+  // nothing may be pushed afterwards.
+  void stop() {
+    if (!thread_.joinable()) {
+      return;
+    }
+    is_stop_requested_.store(true);
+    posted_count_.fetch_add(1);
+    posted_count_.notify_one();
+    thread_.join();
+  }
+
+  // Producer only.
+  void push(ValueType value) {
+    rethrow_if_failed();
+    while (true) {
+      std::uint64_t popped_count = popped_count_.load();
+      if (values_.try_push(std::move(value))) {
+        break;
+      }
+      popped_count_.wait(popped_count);
+    }
+    posted_count_.fetch_add(1);
+    posted_count_.notify_one();
+  }
+
+  bool has_failed() const { return has_failed_.load(); }
+
+  void rethrow_if_failed() const {
+    if (has_failed()) {
+      std::rethrow_exception(maybe_failure_);
+    }
+  }
+
+ private:
+  void run() {
+    while (true) {
+      std::uint64_t posted_count = posted_count_.load();
+      if (auto value = values_.try_pop()) {
+        consume_once(*value);
+        popped_count_.fetch_add(1);
+        popped_count_.notify_one();
+        continue;
+      }
+      if (is_stop_requested_.load()) {
+        return;
+      }
+      posted_count_.wait(posted_count);
+    }
+  }
+
+  void consume_once(ValueType& value) {
+    if (has_failed()) {
+      return;
+    }
+    try {
+      consume_(value);
+    } catch (...) {
+      maybe_failure_ = std::current_exception();
+      has_failed_.store(true);  // Publishes `maybe_failure_`.
+    }
+  }
+
+  std::move_only_function<void(ValueType&)> consume_;
+  SpscQueue<ValueType, Capacity> values_;
+  std::atomic<std::uint64_t> posted_count_ = 0;  // Wakes the worker.
+  std::atomic<std::uint64_t> popped_count_ = 0;  // Wakes a blocked producer.
+  std::atomic<bool> is_stop_requested_ = false;
+  std::atomic<bool> has_failed_ = false;
+  std::exception_ptr maybe_failure_;  // Set once, before `has_failed_`.
+
+  // Declared last so the thread stops before the state above is destroyed.
+  std::jthread thread_;
+};
+
+}  // namespace volcano
@@ -0,0 +1,136 @@
+#include "lib/spsc_queue.hpp"
+
+#include <latch>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+
+TEST_CASE("SpscQueue") {
+  SpscQueue<int, 4> queue;
+
+  SECTION("ShouldPopInPushOrder") {
+    // Precondition.
+    REQUIRE(queue.try_push(1));
+    REQUIRE(queue.try_push(2));
+
+    // Under Test.
+    auto first = queue.try_pop();
+    auto second = queue.try_pop();
+
+    // Postcondition.
+    REQUIRE(first == 1);
+    REQUIRE(second == 2);
+    REQUIRE_FALSE(queue.try_pop().has_value());
+  }
+
+  SECTION("ShouldRejectPushWhenFull") {
+    // Precondition.
+    for (int i = 0; i < 4; ++i) {
+      REQUIRE(queue.try_push(i));
+    }
+
+    // Under Test.
+    bool is_pushed = queue.try_push(4);
+
+    // Postcondition.
+    REQUIRE_FALSE(is_pushed);
+    REQUIRE(queue.size() == 4);
+    REQUIRE(queue.try_pop() == 0);
+    REQUIRE(queue.try_push(4));
+  }
+
+  SECTION("ShouldHandOffAcrossThreads") {
+    // Precondition.
+    constexpr int value_count = 100000;
+
+    // Under Test.
+    std::jthread producer{[&queue] {
+      for (int i = 0; i < value_count; ++i) {
+        while (!queue.try_push(i)) {
+          std::this_thread::yield();
+        }
+      }
+    }};
+
+    // Postcondition.
+    for (int expected = 0; expected < value_count;) {
+      if (auto value = queue.try_pop()) {
+        REQUIRE(*value == expected);
+        ++expected;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    REQUIRE(queue.empty());
+  }
+}
+
+TEST_CASE("SpscWorker") {
+  std::vector<int> consumed;
+
+  SECTION("ShouldConsumeInPushOrder") {
+    // Under Test.
+    {
+      SpscWorker<int, 4> worker{[&consumed](int& value) {
+        consumed.push_back(value);
+      }};
+      for (int i = 0; i < 100; ++i) {
+        worker.push(i);
+      }
+    }
+
+    // Postcondition.
+    REQUIRE(consumed.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(consumed[i] == i);
+    }
+  }
+
+  SECTION("ShouldDrainOnDestruction") {
+    // Precondition.
+    std::latch release{1};
+    {
+      SpscWorker<int, 4> worker{[&](int& value) {
+        release.wait();
+        consumed.push_back(value);
+      }};
+      for (int i = 0; i < 4; ++i) {
+        worker.push(i);
+      }
+
+      // Under Test.
+      release.count_down();
+    }
+
+    // Postcondition.
+    REQUIRE(consumed == std::vector<int>{0, 1, 2, 3});
+  }
+
+  SECTION("ShouldRethrowToProducerAndDropLaterValues") {
+    // Precondition.
+    SpscWorker<int, 4> worker{[&consumed](int& value) {
+      if (value == 1) {
+        throw std::logic_error{"submit failed"};
+      }
+      consumed.push_back(value);
+    }};
+
+    // Under Test.
+    worker.push(0);
+    worker.push(1);
+    while (!worker.has_failed()) {
+      std::this_thread::yield();
+    }
+
+    // Postcondition.
+    REQUIRE_THROWS_AS(worker.rethrow_if_failed(), std::logic_error);
+    REQUIRE_THROWS_AS(worker.push(2), std::logic_error);
+    REQUIRE(consumed == std::vector<int>{0});
+  }
+}
+
+}  // namespace volcano
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lib/base.hpp"
+
+namespace volcano {
+
+//------------------------------------------------------------------------------
+// Fixed set of worker threads for fork-join parallelism. The calling thread
+// joins in, so `worker_count()` is one more than the number of threads.
+// Worker indices are stable, which lets callers keep per-worker state (eg.
+// command pools) without locking.
+class ThreadPool final {
+ public:
+  DECLARE_COPY_DELETE(ThreadPool);
+  DECLARE_MOVE_DELETE(ThreadPool);  // Workers refer to `this`.
+
+  explicit ThreadPool(std::uint32_t thread_count =
+                          std::max(std::thread::hardware_concurrency(), 1u) -
+                          1) {
+    threads_.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; ++i) {
+      threads_.emplace_back(
+          [this, worker_index = i + 1](std::stop_token stop_token) {
+            run_worker(worker_index, stop_token);
+          });
+    }
+  }
+
+  ~ThreadPool() {
+    for (auto&& thread : threads_) {
+      thread.request_stop();
+    }
+    {
+      std::lock_guard lock{mutex_};
+      ++generation_;
+    }
+    job_posted_.notify_all();
+  }
+
+  std::uint32_t worker_count() const {
+    return narrow_cast<std::uint32_t>(threads_.size()) + 1;
+  }
+
+  // Calls `function(worker_index, item_index)` once for every item index in
+  // [0, item_count), spread over all workers, and returns when all are done.
+  // The calling thread is worker 0. Not reentrant. Should `function` throw,
+  // items not yet started are skipped, and the first exception is rethrown
+  // here once no worker is running it any more.
+  template <typename FunctionType>
+  void parallel_for(std::uint32_t item_count, FunctionType&& function) {
+    if (item_count == 0) {
+      return;
+    }
+
+    std::unique_lock lock{mutex_};
+
+    // Stragglers from the previous job may still be reading it.
+    job_done_.wait(lock, [this] { return active_worker_count_ == 0; });
+
+    job_ = Job{
+        .context = std::addressof(function),
+        .invoke =
+            [](void* context, std::uint32_t worker_index,
+               std::uint32_t item_index) {
+              (*static_cast<std::remove_reference_t<FunctionType>*>(
+                  context))(worker_index, item_index);
+            },
+        .item_count = item_count,
+    };
+    next_item_.store(0);
+    remaining_item_count_.store(item_count);
+    has_failed_.store(false);
+    ++generation_;
+    ++active_worker_count_;
+    lock.unlock();
+    job_posted_.notify_all();
+
+    run_items(0);
+
+    lock.lock();
+    --active_worker_count_;
+    job_done_.wait(lock, [this] { return remaining_item_count_.load() == 0; });
+    if (maybe_failure_) {
+      std::rethrow_exception(std::exchange(maybe_failure_, nullptr));
+    }
+  }
+
+ private:
+  struct Job final {
+    void* context = nullptr;
+    void (*invoke)(void*, std::uint32_t, std::uint32_t) = nullptr;
+    std::uint32_t item_count = 0;
+  };
+
+  void run_worker(std::uint32_t worker_index, std::stop_token stop_token) {
+    std::uint64_t seen_generation = 0;
+    while (true) {
+      {
+        std::unique_lock lock{mutex_};
+        job_posted_.wait(lock, [&] {
+          return generation_ != seen_generation || stop_token.stop_requested();
+        });
+        if (stop_token.stop_requested()) {
+          return;
+        }
+        seen_generation = generation_;
+        ++active_worker_count_;
+      }
+
+      run_items(worker_index);
+
+      {
+        std::lock_guard lock{mutex_};
+        --active_worker_count_;
+      }
+      job_done_.notify_all();
+    }
+  }
+
+  // Doesn't throw, so that every item is counted off even after a failure.
+  void run_items(std::uint32_t worker_index) {
+    std::uint32_t item_index = 0;
+    while ((item_index = next_item_.fetch_add(1)) < job_.item_count) {
+      if (!has_failed_.load()) {
+        try {
+          job_.invoke(job_.context, worker_index, item_index);
+        } catch (...) {
+          std::lock_guard lock{mutex_};
+          if (!has_failed_.exchange(true)) {
+            maybe_failure_ = std::current_exception();
+          }
+        }
+      }
+      if (remaining_item_count_.fetch_sub(1) == 1) {
+        std::lock_guard lock{mutex_};
+        job_done_.notify_all();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable job_posted_;
+  std::condition_variable job_done_;
+  std::uint64_t generation_ = 0;
+  std::uint32_t active_worker_count_ = 0;
+
+  Job job_;
+  std::atomic<std::uint32_t> next_item_ = 0;
+  std::atomic<std::uint32_t> remaining_item_count_ = 0;
+  std::atomic<bool> has_failed_ = false;
+  std::exception_ptr maybe_failure_;  // Guarded by `mutex_`.
+
+  // Declared last so workers stop before the state above is destroyed.
+  std::vector<std::jthread> threads_;
+};
+
+}  // namespace volcano
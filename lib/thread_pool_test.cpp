@@ -0,0 +1,109 @@
+#include "lib/thread_pool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "lib/testing.hpp"
+
+namespace volcano {
+
+TEST_CASE("ThreadPool") {
+  ThreadPool thread_pool{3};
+
+  SECTION("ShouldCountCallingThread") {
+    REQUIRE(thread_pool.worker_count() == 4);
+  }
+
+  SECTION("ShouldVisitEveryItemOnce") {
+    // Precondition.
+    std::vector<std::atomic<int>> visits(1000);
+
+    // Under Test.
+    thread_pool.parallel_for(
+        visits.size(), [&](std::uint32_t, std::uint32_t item_index) {
+          visits[item_index].fetch_add(1);
+        });
+
+    // Postcondition.
+    for (auto&& visit : visits) {
+      REQUIRE(visit.load() == 1);
+    }
+  }
+
+  SECTION("ShouldPassValidWorkerIndices") {
+    // Precondition.
+    std::vector<std::atomic<int>> worker_items(thread_pool.worker_count());
+
+    // Under Test.
+    for (int job = 0; job < 100; ++job) {
+      thread_pool.parallel_for(
+          64, [&](std::uint32_t worker_index, std::uint32_t) {
+            REQUIRE(worker_index < worker_items.size());
+            worker_items[worker_index].fetch_add(1);
+          });
+    }
+
+    // Postcondition.
+    int total = 0;
+    for (auto&& items : worker_items) {
+      total += items.load();
+    }
+    REQUIRE(total == 100 * 64);
+  }
+
+  SECTION("ShouldRethrowAndStayUsable") {
+    // Precondition.
+    std::atomic<int> count = 0;
+
+    // Under Test.
+    REQUIRE_THROWS_AS(
+        thread_pool.parallel_for(100,
+                                 [](std::uint32_t, std::uint32_t item_index) {
+                                   if (item_index == 7) {
+                                     throw std::logic_error{"item failed"};
+                                   }
+                                 }),
+        std::logic_error);
+    thread_pool.parallel_for(
+        100, [&](std::uint32_t, std::uint32_t) { count.fetch_add(1); });
+
+    // Postcondition.
+    REQUIRE(count.load() == 100);
+  }
+}
+
+TEST_CASE("ThreadPoolWithoutThreads") {
+  ThreadPool thread_pool{0};
+
+  SECTION("ShouldRunOnCallingThread") {
+    // Under Test.
+    int count = 0;
+    thread_pool.parallel_for(10, [&](std::uint32_t worker_index,
+                                     std::uint32_t) {
+      REQUIRE(worker_index == 0);
+      ++count;
+    });
+
+    // Postcondition.
+    REQUIRE(count == 10);
+  }
+
+  SECTION("ShouldRethrowFromCallingThread") {
+    // Under Test.
+    REQUIRE_THROWS_AS(thread_pool.parallel_for(
+                          10,
+                          [](std::uint32_t, std::uint32_t) {
+                            throw std::logic_error{"item failed"};
+                          }),
+                      std::logic_error);
+
+    // Postcondition.
+    int count = 0;
+    thread_pool.parallel_for(10,
+                             [&](std::uint32_t, std::uint32_t) { ++count; });
+    REQUIRE(count == 10);
+  }
+}
+
+}  // namespace volcano
@@ -11,5 +11,8 @@ inline std::vector<std::uint32_t> vertex_shader_spirv_bin = {
 inline std::vector<std::uint32_t> fragment_shader_spirv_bin = {
 #include "shaders/hello_triangle.frag.spv.inl"
 };
+inline std::vector<std::uint32_t> cull_instances_compute_shader_spirv_bin = {
+#include "shaders/cull_instances.comp.spv.inl"
+};
 
 }  // namespace volcano
@@ -0,0 +1,6 @@
+#!/bin/sh
+# Validates each SPIR-V module given for the Vulkan version the device needs.
+set -e
+for module in "$@"; do
+  spirv-val --target-env vulkan1.2 "$module"
+done
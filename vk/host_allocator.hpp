@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "lib/base.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace volcano::vk {
+
+//------------------------------------------------------------------------------
+
+namespace impl {
+constexpr std::size_t SYSTEM_ALLOCATION_SCOPE_COUNT =
+    VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+constexpr std::size_t COMMAND_ARENA_BYTE_COUNT = 256ull << 10;
+constexpr std::size_t COMMAND_ARENA_COUNT = 8;  // Threads in commands at once.
+
+// Precedes every allocation handed to the driver.
+struct HostAllocationHeader final {
+  std::size_t byte_count = 0;
+  std::size_t byte_alignment = 0;
+  std::size_t byte_offset = 0;  // From the start of the underlying storage.
+  ::VkSystemAllocationScope scope = VK_SYSTEM_ALLOCATION_SCOPE_COMMAND;
+  bool is_arena = false;
+  std::size_t arena_index = 0;
+};
+
+constexpr std::size_t align_up_host(std::size_t value, std::size_t alignment) {
+  return ((value + alignment - 1) / alignment) * alignment;
+}
+
+// Bump allocator for allocations that only live for the duration of one
+// command, which by definition never leave the calling thread. A thread
+// claims the arena with its first allocation and releases it with its last
+// free, which also rewinds it. Called from driver callbacks, so never throws.
+class CommandArena final {
+ public:
+  DECLARE_COPY_DELETE(CommandArena);
+  DECLARE_MOVE_DELETE(CommandArena);
+
+  CommandArena() = default;
+  ~CommandArena() = default;
+
+  // Whether the arena is now held by `thread_id`, which may already have
+  // held it.
+  bool try_claim(std::thread::id thread_id) noexcept {
+    std::thread::id unowned;
+    return owner_.load() == thread_id ||
+           owner_.compare_exchange_strong(unowned, thread_id);
+  }
+
+  // Returns the start of storage for `byte_count` bytes such that
+  // `storage + byte_offset` is aligned, or nullptr when exhausted. Only by
+  // the thread holding the arena.
+  std::byte* allocate(std::size_t byte_count, std::size_t byte_offset,
+                      std::size_t byte_alignment) noexcept {
+    if (!storage_) {
+      storage_.reset(new (std::nothrow) std::byte[COMMAND_ARENA_BYTE_COUNT]);
+    }
+
+    auto base = reinterpret_cast<std::uintptr_t>(storage_.get());
+    std::size_t begin =
+        align_up_host(base + head_ + byte_offset, byte_alignment) -
+        byte_offset - base;
+    if (!storage_ || begin + byte_count > COMMAND_ARENA_BYTE_COUNT) {
+      if (live_count_ == 0) {
+        owner_.store(std::thread::id{});
+      }
+      return nullptr;
+    }
+
+    head_ = begin + byte_count;
+    ++live_count_;
+    return storage_.get() + begin;
+  }
+
+  void free() noexcept {
+    assert(live_count_ > 0);
+    if (--live_count_ == 0) {
+      head_ = 0;
+      owner_.store(std::thread::id{});
+    }
+  }
+
+  std::size_t used_byte_count() const { return head_; }
+
+ private:
+  std::atomic<std::thread::id> owner_;
+  std::unique_ptr<std::byte[]> storage_;
+  std::size_t head_ = 0;
+  std::size_t live_count_ = 0;
+};
+}  // namespace impl
+
+//------------------------------------------------------------------------------
+
+struct HostAllocationStats final {
+  std::size_t byte_count = 0;        // Currently live.
+  std::size_t peak_byte_count = 0;   // High water mark of `byte_count`.
+  std::size_t allocation_count = 0;  // Currently live.
+  std::size_t total_allocation_count = 0;
+  std::size_t internal_byte_count = 0;  // Driver allocations we only observe.
+};
+
+enum class HostAllocatorMode {
+  HEAP,
+  COMMAND_ARENA,  // Serve COMMAND scope from arenas held per thread.
+};
+
+// `VkAllocationCallbacks` that account for every driver host allocation per
+// `VkSystemAllocationScope`. Install by pointing `vk::ALLOCATOR` at
+// `callbacks()` before the instance is created, and keep the allocator alive
+// until every object has been destroyed.
+class HostAllocator final {
+ public:
+  DECLARE_COPY_DELETE(HostAllocator);
+  DECLARE_MOVE_DELETE(HostAllocator);  // Callbacks refer to `this`.
+
+  explicit HostAllocator(HostAllocatorMode mode = HostAllocatorMode::HEAP)
+      : mode_{mode} {
+    callbacks_ = ::VkAllocationCallbacks{
+        .pUserData = this,
+        .pfnAllocation = allocate_callback,
+        .pfnReallocation = reallocate_callback,
+        .pfnFree = free_callback,
+        .pfnInternalAllocation = internal_allocation_callback,
+        .pfnInternalFree = internal_free_callback,
+    };
+  }
+
+  ~HostAllocator() = default;
+
+  const ::VkAllocationCallbacks* callbacks() const { return &callbacks_; }
+  HostAllocatorMode mode() const { return mode_; }
+
+  HostAllocationStats stats(::VkSystemAllocationScope scope) const {
+    CHECK_PRECONDITION(scope < impl::SYSTEM_ALLOCATION_SCOPE_COUNT);
+    return counters_[scope].load();
+  }
+
+  HostAllocationStats total_stats() const { return total_counters_.load(); }
+
+  void* allocate(std::size_t byte_count,      //
+                 std::size_t byte_alignment,  //
+                 ::VkSystemAllocationScope scope) {
+    if (byte_count == 0) {
+      return nullptr;
+    }
+    byte_alignment =
+        std::max(byte_alignment, alignof(impl::HostAllocationHeader));
+    std::size_t byte_offset =
+        impl::align_up_host(sizeof(impl::HostAllocationHeader), byte_alignment);
+
+    impl::HostAllocationHeader header{
+        .byte_count = byte_count,
+        .byte_alignment = byte_alignment,
+        .byte_offset = byte_offset,
+        .scope = scope,
+    };
+
+    std::byte* storage = nullptr;
+    if (mode_ == HostAllocatorMode::COMMAND_ARENA &&
+        scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+      // Threads beyond the arena count fall back to the heap.
+      std::thread::id thread_id = std::this_thread::get_id();
+      for (std::size_t i = 0; i < command_arenas_.size(); ++i) {
+        if (command_arenas_[i].try_claim(thread_id)) {
+          storage = command_arenas_[i].allocate(byte_offset + byte_count,
+                                                byte_offset, byte_alignment);
+          header.is_arena = storage != nullptr;
+          header.arena_index = i;
+          break;
+        }
+      }
+    }
+    if (!storage) {
+      storage = static_cast<std::byte*>(
+          ::operator new(byte_offset + byte_count,
+                         std::align_val_t{byte_alignment}, std::nothrow));
+    }
+    if (!storage) {
+      return nullptr;
+    }
+
+    std::byte* memory = storage + byte_offset;
+    std::memcpy(memory - sizeof(header), &header, sizeof(header));
+
+    counters_[scope].record_allocation(byte_count);
+    total_counters_.record_allocation(byte_count);
+    return memory;
+  }
+
+  void* reallocate(void* original,              //
+                   std::size_t byte_count,      //
+                   std::size_t byte_alignment,  //
+                   ::VkSystemAllocationScope scope) {
+    if (!original) {
+      return allocate(byte_count, byte_alignment, scope);
+    }
+    if (byte_count == 0) {
+      free(original);
+      return nullptr;
+    }
+
+    void* memory = allocate(byte_count, byte_alignment, scope);
+    if (memory) {
+      std::memcpy(memory, original,
+                  std::min(byte_count, header_of(original).byte_count));
+      free(original);
+    }
+    return memory;
+  }
+
+  void free(void* memory) {
+    if (!memory) {
+      return;
+    }
+
+    impl::HostAllocationHeader header = header_of(memory);
+    counters_[header.scope].record_free(header.byte_count);
+    total_counters_.record_free(header.byte_count);
+
+    if (header.is_arena) {
+      command_arenas_[header.arena_index].free();
+    } else {
+      ::operator delete(static_cast<std::byte*>(memory) - header.byte_offset,
+                        std::align_val_t{header.byte_alignment});
+    }
+  }
+
+ private:
+  struct Counters final {
+    std::atomic<std::size_t> byte_count = 0;
+    std::atomic<std::size_t> peak_byte_count = 0;
+    std::atomic<std::size_t> allocation_count = 0;
+    std::atomic<std::size_t> total_allocation_count = 0;
+    std::atomic<std::size_t> internal_byte_count = 0;
+
+    void record_allocation(std::size_t count) {
+      std::size_t current = byte_count.fetch_add(count) + count;
+      std::size_t peak = peak_byte_count.load();
+      while (current > peak &&
+             !peak_byte_count.compare_exchange_weak(peak, current)) {
+      }
+      allocation_count.fetch_add(1);
+      total_allocation_count.fetch_add(1);
+    }
+
+    void record_free(std::size_t count) {
+      byte_count.fetch_sub(count);
+      allocation_count.fetch_sub(1);
+    }
+
+    HostAllocationStats load() const {
+      return HostAllocationStats{
+          .byte_count = byte_count.load(),
+          .peak_byte_count = peak_byte_count.load(),
+          .allocation_count = allocation_count.load(),
+          .total_allocation_count = total_allocation_count.load(),
+          .internal_byte_count = internal_byte_count.load(),
+      };
+    }
+  };
+
+  static impl::HostAllocationHeader header_of(void* memory) {
+    impl::HostAllocationHeader header;
+    std::memcpy(&header,
+                static_cast<std::byte*>(memory) - sizeof(header),
+                sizeof(header));
+    return header;
+  }
+
+  static void* VKAPI_PTR allocate_callback(void* user_data,
+                                           std::size_t byte_count,
+                                           std::size_t byte_alignment,
+                                           ::VkSystemAllocationScope scope) {
+    return static_cast<HostAllocator*>(user_data)->allocate(
+        byte_count, byte_alignment, scope);
+  }
+
+  static void* VKAPI_PTR reallocate_callback(void* user_data,
+                                             void* original,
+                                             std::size_t byte_count,
+                                             std::size_t byte_alignment,
+                                             ::VkSystemAllocationScope scope) {
+    return static_cast<HostAllocator*>(user_data)->reallocate(
+        original, byte_count, byte_alignment, scope);
+  }
+
+  static void VKAPI_PTR free_callback(void* user_data, void* memory) {
+    static_cast<HostAllocator*>(user_data)->free(memory);
+  }
+
+  static void VKAPI_PTR
+  internal_allocation_callback(void* user_data,                      //
+                               std::size_t byte_count,               //
+                               ::VkInternalAllocationType /*type*/,  //
+                               ::VkSystemAllocationScope scope) {
+    auto* self = static_cast<HostAllocator*>(user_data);
+    self->counters_[scope].internal_byte_count.fetch_add(byte_count);
+    self->total_counters_.internal_byte_count.fetch_add(byte_count);
+  }
+
+  static void VKAPI_PTR
+  internal_free_callback(void* user_data,                      //
+                         std::size_t byte_count,               //
+                         ::VkInternalAllocationType /*type*/,  //
+                         ::VkSystemAllocationScope scope) {
+    auto* self = static_cast<HostAllocator*>(user_data);
+    self->counters_[scope].internal_byte_count.fetch_sub(byte_count);
+    self->total_counters_.internal_byte_count.fetch_sub(byte_count);
+  }
+
+  HostAllocatorMode mode_ = HostAllocatorMode::HEAP;
+  ::VkAllocationCallbacks callbacks_{};
+  std::array<Counters, impl::SYSTEM_ALLOCATION_SCOPE_COUNT> counters_;
+  Counters total_counters_;
+  std::array<impl::CommandArena, impl::COMMAND_ARENA_COUNT> command_arenas_;
+};
+
+}  // namespace volcano::vk
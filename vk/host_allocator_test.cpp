@@ -0,0 +1,162 @@
+#include "vk/host_allocator.hpp"
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "lib/testing.hpp"
+
+namespace volcano::vk {
+
+//------------------------------------------------------------------------------
+
+TEST_CASE("HostAllocator") {
+  HostAllocator allocator;
+  const ::VkAllocationCallbacks* callbacks = allocator.callbacks();
+
+  SECTION("ShouldHonorAlignment") {
+    // Under Test.
+    void* memory = callbacks->pfnAllocation(callbacks->pUserData, 100, 256,
+                                            VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    // Postcondition.
+    REQUIRE(memory != nullptr);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(memory) % 256 == 0);
+    callbacks->pfnFree(callbacks->pUserData, memory);
+  }
+
+  SECTION("ShouldCountPerScope") {
+    // Under Test.
+    void* memory = callbacks->pfnAllocation(callbacks->pUserData, 100, 8,
+                                            VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    // Postcondition.
+    auto stats = allocator.stats(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+    REQUIRE(stats.byte_count == 100);
+    REQUIRE(stats.allocation_count == 1);
+    REQUIRE(allocator.stats(VK_SYSTEM_ALLOCATION_SCOPE_DEVICE).byte_count ==
+            0);
+    REQUIRE(allocator.total_stats().byte_count == 100);
+    callbacks->pfnFree(callbacks->pUserData, memory);
+  }
+
+  SECTION("ShouldKeepPeakAfterFree") {
+    // Precondition.
+    void* a = callbacks->pfnAllocation(callbacks->pUserData, 100, 8,
+                                       VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+    void* b = callbacks->pfnAllocation(callbacks->pUserData, 50, 8,
+                                       VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+
+    // Under Test.
+    callbacks->pfnFree(callbacks->pUserData, a);
+    callbacks->pfnFree(callbacks->pUserData, b);
+
+    // Postcondition.
+    auto stats = allocator.stats(VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+    REQUIRE(stats.byte_count == 0);
+    REQUIRE(stats.peak_byte_count == 150);
+    REQUIRE(stats.allocation_count == 0);
+    REQUIRE(stats.total_allocation_count == 2);
+  }
+
+  SECTION("ShouldPreserveContentsOnReallocate") {
+    // Precondition.
+    auto* memory = static_cast<char*>(callbacks->pfnAllocation(
+        callbacks->pUserData, 4, 4, VK_SYSTEM_ALLOCATION_SCOPE_CACHE));
+    std::memcpy(memory, "abc", 4);
+
+    // Under Test.
+    auto* grown = static_cast<char*>(callbacks->pfnReallocation(
+        callbacks->pUserData, memory, 64, 4, VK_SYSTEM_ALLOCATION_SCOPE_CACHE));
+
+    // Postcondition.
+    REQUIRE(std::string{grown} == "abc");
+    REQUIRE(allocator.stats(VK_SYSTEM_ALLOCATION_SCOPE_CACHE).byte_count ==
+            64);
+    callbacks->pfnFree(callbacks->pUserData, grown);
+  }
+
+  SECTION("ShouldTrackInternalAllocations") {
+    // Under Test.
+    callbacks->pfnInternalAllocation(
+        callbacks->pUserData, 32, VK_INTERNAL_ALLOCATION_TYPE_EXECUTABLE,
+        VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE);
+
+    // Postcondition.
+    REQUIRE(allocator.stats(VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE)
+                .internal_byte_count == 32);
+    callbacks->pfnInternalFree(
+        callbacks->pUserData, 32, VK_INTERNAL_ALLOCATION_TYPE_EXECUTABLE,
+        VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE);
+  }
+}
+
+TEST_CASE("HostAllocatorCommandArena") {
+  HostAllocator allocator{HostAllocatorMode::COMMAND_ARENA};
+
+  SECTION("ShouldRewindOnceCommandAllocationsAreFreed") {
+    // Precondition.
+    void* a = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+    void* b = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+    REQUIRE(a != b);
+    allocator.free(a);
+    allocator.free(b);
+
+    // Under Test.
+    void* c = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+
+    // Postcondition.
+    REQUIRE(c == a);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(c) % 16 == 0);
+    allocator.free(c);
+  }
+
+  SECTION("ShouldNotShareArenasBetweenAllocators") {
+    // Precondition.
+    HostAllocator other_allocator{HostAllocatorMode::COMMAND_ARENA};
+    void* a = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+    void* other =
+        other_allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+    allocator.free(a);
+
+    // Under Test.
+    void* b = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+
+    // Postcondition.
+    REQUIRE(b == a);
+    REQUIRE(other != a);
+    allocator.free(b);
+    other_allocator.free(other);
+  }
+
+  SECTION("ShouldGiveConcurrentThreadsTheirOwnArenas") {
+    // Precondition.
+    void* a = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+
+    // Under Test.
+    void* b = nullptr;
+    std::thread{[&] {
+      b = allocator.allocate(64, 16, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+      allocator.free(b);
+    }}.join();
+
+    // Postcondition.
+    REQUIRE(b != nullptr);
+    REQUIRE(b != a);
+    allocator.free(a);
+  }
+
+  SECTION("ShouldFallBackToHeapWhenExhausted") {
+    // Under Test.
+    void* memory = allocator.allocate(impl::COMMAND_ARENA_BYTE_COUNT, 8,
+                                      VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+
+    // Postcondition.
+    REQUIRE(memory != nullptr);
+    REQUIRE(allocator.stats(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND).byte_count ==
+            impl::COMMAND_ARENA_BYTE_COUNT);
+    allocator.free(memory);
+  }
+}
+
+}  // namespace volcano::vk
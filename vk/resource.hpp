@@ -1,7 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "lib/base.hpp"
@@ -18,11 +22,146 @@ inline const ::VkAllocationCallbacks* ALLOCATOR = nullptr;
 
 //------------------------------------------------------------------------------
 // NOTE: Copies of data used to create objects (*`CreateInfo`s) are retained for
-// checking and debugging purposes. This metadata is kept on the heap in
-// move-only form to avoid copies and maintain stable addresses.
+// checking and debugging purposes. This metadata is kept in move-only form to
+// avoid copies. The storage policy decides where it lives:
+//  - `PooledBoxStorage` (default) keeps stable addresses across moves, taking
+//    slots from a per-type slab pool so steady state never touches the heap.
+//  - `InlineBoxStorage` keeps the structure in place; for transient wrappers
+//    whose address is only used for the duration of a call.
+//  - `HeapBoxStorage` allocates each structure individually.
 
 namespace impl {
 template <typename VkType>
+class HeapBoxStorage final {
+ public:
+  DECLARE_COPY_DELETE(HeapBoxStorage);
+  DECLARE_MOVE_DEFAULT(HeapBoxStorage);
+
+  HeapBoxStorage() = default;
+  ~HeapBoxStorage() = default;
+
+  explicit HeapBoxStorage(const VkType& that)
+      : vk_object_{std::make_unique<VkType>(that)} {}
+
+  VkType* get() noexcept { return vk_object_.get(); }
+  const VkType* get() const noexcept { return vk_object_.get(); }
+
+ private:
+  std::unique_ptr<VkType> vk_object_ = std::make_unique<VkType>();
+};
+
+// Process-wide free list of `VkType` slots, grown a slab at a time and never
+// shrunk.
+template <typename VkType>
+class BoxPool final {
+ public:
+  DECLARE_COPY_DELETE(BoxPool);
+  DECLARE_MOVE_DELETE(BoxPool);
+
+  BoxPool() = default;
+  ~BoxPool() = default;
+
+  static BoxPool& instance() {
+    static BoxPool pool;
+    return pool;
+  }
+
+  VkType* acquire(const VkType& that) {
+    Slot* slot = nullptr;
+    {
+      std::lock_guard lock{mutex_};
+      if (!free_slots_) {
+        grow();
+      }
+      slot = std::exchange(free_slots_, free_slots_->next_free);
+    }
+    return std::construct_at(std::addressof(slot->vk_object), that);
+  }
+
+  void release(VkType* vk_object) {
+    Slot* slot = reinterpret_cast<Slot*>(vk_object);
+    std::lock_guard lock{mutex_};
+    slot->next_free = std::exchange(free_slots_, slot);
+  }
+
+ private:
+  static constexpr std::size_t SLAB_SLOT_COUNT = 64;
+
+  union Slot {
+    Slot* next_free;
+    VkType vk_object;
+  };
+  static_assert(std::is_trivially_destructible_v<VkType>);
+
+  void grow() {
+    auto& slab = slabs_.emplace_back(std::make_unique<Slot[]>(SLAB_SLOT_COUNT));
+    for (std::size_t i = 0; i < SLAB_SLOT_COUNT; ++i) {
+      slab[i].next_free = std::exchange(free_slots_, std::addressof(slab[i]));
+    }
+  }
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Slot[]>> slabs_;
+  Slot* free_slots_ = nullptr;
+};
+
+template <typename VkType>
+class PooledBoxStorage final {
+ public:
+  DECLARE_COPY_DELETE(PooledBoxStorage);
+
+  PooledBoxStorage() : PooledBoxStorage{VkType{}} {}
+  ~PooledBoxStorage() {
+    if (vk_object_) {
+      BoxPool<VkType>::instance().release(vk_object_);
+    }
+  }
+
+  explicit PooledBoxStorage(const VkType& that)
+      : vk_object_{BoxPool<VkType>::instance().acquire(that)} {}
+
+  PooledBoxStorage(PooledBoxStorage&& that) noexcept
+      : vk_object_{std::exchange(that.vk_object_, nullptr)} {}
+
+  PooledBoxStorage& operator=(PooledBoxStorage&& that) noexcept {
+    if (this != &that) {
+      if (vk_object_) {
+        BoxPool<VkType>::instance().release(vk_object_);
+      }
+      vk_object_ = std::exchange(that.vk_object_, nullptr);
+    }
+    return *this;
+  }
+
+  VkType* get() noexcept { return vk_object_; }
+  const VkType* get() const noexcept { return vk_object_; }
+
+ private:
+  VkType* vk_object_ = nullptr;
+};
+
+template <typename VkType>
+class InlineBoxStorage final {
+ public:
+  DECLARE_COPY_DELETE(InlineBoxStorage);
+  DECLARE_MOVE_DEFAULT(InlineBoxStorage);
+
+  InlineBoxStorage() = default;
+  ~InlineBoxStorage() = default;
+
+  explicit InlineBoxStorage(const VkType& that) : vk_object_{that} {}
+
+  VkType* get() noexcept { return std::addressof(vk_object_); }
+  const VkType* get() const noexcept { return std::addressof(vk_object_); }
+
+ private:
+  VkType vk_object_{};
+};
+
+template <typename VkType>
+using DefaultBoxStorage = PooledBoxStorage<VkType>;
+
+template <typename VkType, typename StorageType = DefaultBoxStorage<VkType>>
 class BoxAdapterBase {
  public:
   DECLARE_COPY_DELETE(BoxAdapterBase);
@@ -31,25 +170,26 @@ class BoxAdapterBase {
   BoxAdapterBase() = default;
   ~BoxAdapterBase() = default;
 
-  BoxAdapterBase(const VkType& that)
-      : vk_object_{std::make_unique<VkType>(that)} {}
+  BoxAdapterBase(const VkType& that) : storage_{that} {}
 
-  operator VkType&() { return *vk_object_; };
-  operator const VkType&() { return *vk_object_; };
+  operator VkType&() { return *storage_.get(); };
+  operator const VkType&() { return *storage_.get(); };
 
-  VkType& operator()() noexcept { return *vk_object_; };
-  const VkType& operator()() const noexcept { return *vk_object_; };
+  VkType& operator()() noexcept { return *storage_.get(); };
+  const VkType& operator()() const noexcept { return *storage_.get(); };
 
-  VkType* address() noexcept { return vk_object_.get(); }
-  const VkType* address() const noexcept { return vk_object_.get(); }
+  VkType* address() noexcept { return storage_.get(); }
+  const VkType* address() const noexcept { return storage_.get(); }
 
  private:
-  std::unique_ptr<VkType> vk_object_ = std::make_unique<VkType>();
+  StorageType storage_;
 };
 
-template <typename VkType, ::VkStructureType TypeValue>
-class TypeValueAdapterBase : public BoxAdapterBase<VkType> {
-  using BaseType = BoxAdapterBase<VkType>;
+template <typename VkType,                 //
+          ::VkStructureType TypeValue,     //
+          typename StorageType = DefaultBoxStorage<VkType>>
+class TypeValueAdapterBase : public BoxAdapterBase<VkType, StorageType> {
+  using BaseType = BoxAdapterBase<VkType, StorageType>;
 
  public:
   TypeValueAdapterBase() {
@@ -92,7 +232,8 @@ class DeviceQueueCreateInfo final         //
 class SubmitInfo final                    //
     : public impl::TypeValueAdapterBase<  //
           ::VkSubmitInfo,                 //
-          VK_STRUCTURE_TYPE_SUBMIT_INFO> {};
+          VK_STRUCTURE_TYPE_SUBMIT_INFO,  //
+          impl::InlineBoxStorage<::VkSubmitInfo>> {};
 
 class SemaphoreCreateInfo final           //
     : public impl::TypeValueAdapterBase<  //
@@ -122,13 +263,19 @@ class CommandBufferAllocateInfo final     //
 class CommandBufferBeginInfo final        //
     : public impl::TypeValueAdapterBase<  //
           ::VkCommandBufferBeginInfo,     //
-          VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO> {};
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+          impl::InlineBoxStorage<::VkCommandBufferBeginInfo>> {};
 
 class CommandPoolCreateInfo final         //
     : public impl::TypeValueAdapterBase<  //
           ::VkCommandPoolCreateInfo,      //
           VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO> {};
 
+class ImageCreateInfo final               //
+    : public impl::TypeValueAdapterBase<  //
+          ::VkImageCreateInfo,            //
+          VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO> {};
+
 class ImageViewCreateInfo final           //
     : public impl::TypeValueAdapterBase<  //
           ::VkImageViewCreateInfo,        //
@@ -152,18 +299,39 @@ class SwapchainCreateInfo final           //
 class PresentInfo final                   //
     : public impl::TypeValueAdapterBase<  //
           ::VkPresentInfoKHR,             //
-          VK_STRUCTURE_TYPE_PRESENT_INFO_KHR> {};
+          VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+          impl::InlineBoxStorage<::VkPresentInfoKHR>> {};
 
 class FramebufferCreateInfo final         //
     : public impl::TypeValueAdapterBase<  //
           ::VkFramebufferCreateInfo,      //
           VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO> {};
 
+class PipelineCacheCreateInfo final       //
+    : public impl::TypeValueAdapterBase<  //
+          ::VkPipelineCacheCreateInfo,    //
+          VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO> {};
+
 class GraphicsPipelineCreateInfo final     //
     : public impl::TypeValueAdapterBase<   //
           ::VkGraphicsPipelineCreateInfo,  //
           VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO> {};
 
+class ComputePipelineCreateInfo final     //
+    : public impl::TypeValueAdapterBase<  //
+          ::VkComputePipelineCreateInfo,  //
+          VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO> {};
+
+class DescriptorSetLayoutCreateInfo final     //
+    : public impl::TypeValueAdapterBase<      //
+          ::VkDescriptorSetLayoutCreateInfo,  //
+          VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO> {};
+
+class DescriptorPoolCreateInfo final      //
+    : public impl::TypeValueAdapterBase<  //
+          ::VkDescriptorPoolCreateInfo,   //
+          VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO> {};
+
 class PipelineShaderStageCreateInfo final     //
     : public impl::TypeValueAdapterBase<      //
           ::VkPipelineShaderStageCreateInfo,  //
@@ -177,7 +345,8 @@ class RenderPassCreateInfo final          //
 class RenderPassBeginInfo final           //
     : public impl::TypeValueAdapterBase<  //
           ::VkRenderPassBeginInfo,        //
-          VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO> {};
+          VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+          impl::InlineBoxStorage<::VkRenderPassBeginInfo>> {};
 
 //------------------------------------------------------------------------------
 
@@ -274,6 +443,13 @@ using MemoryRequirementsBase =   //
         ::VkMemoryRequirements,  //
         ::vkGetBufferMemoryRequirements>;
 
+using ImageMemoryRequirementsBase =  //
+    impl::PropertyQuerier2Base<      //
+        ::VkDevice,                  //
+        ::VkImage,                   //
+        ::VkMemoryRequirements,      //
+        ::vkGetImageMemoryRequirements>;
+
 using PhysicalDevicePropertiesBase =   //
     impl::PropertyQuerier1Base<        //
         ::VkPhysicalDevice,            //
@@ -304,6 +480,9 @@ using PhysicalDeviceSurfaceCapabilitiesBase =  //
 DERIVE_FINAL_WITH_CONSTRUCTORS(MemoryRequirements,  //
                                MemoryRequirementsBase);
 
+DERIVE_FINAL_WITH_CONSTRUCTORS(ImageMemoryRequirements,  //
+                               ImageMemoryRequirementsBase);
+
 DERIVE_FINAL_WITH_CONSTRUCTORS(PhysicalDeviceProperties,  //
                                PhysicalDevicePropertiesBase);
 
@@ -845,6 +1024,15 @@ using CommandBufferBuilderBase =             //
         impl::begin_command_buffer_adapter,  //
         impl::end_command_buffer_adapter>;
 
+using ImageBase =                             //
+    impl::DefaultParentedHandleResourceBase<  //
+        ::VkDevice,                           //
+        ::VkImage,                            //
+        ::VkImageCreateInfo,                  //
+        ImageCreateInfo,                      //
+        ::vkCreateImage,                      //
+        ::vkDestroyImage>;
+
 using ImageViewBase =                         //
     impl::DefaultParentedHandleResourceBase<  //
         ::VkDevice,                           //
@@ -918,6 +1106,15 @@ using FramebufferBase =                       //
         ::vkCreateFramebuffer,                //
         ::vkDestroyFramebuffer>;
 
+using PipelineCacheBase =                     //
+    impl::DefaultParentedHandleResourceBase<  //
+        ::VkDevice,                           //
+        ::VkPipelineCache,                    //
+        ::VkPipelineCacheCreateInfo,          //
+        PipelineCacheCreateInfo,              //
+        ::vkCreatePipelineCache,              //
+        ::vkDestroyPipelineCache>;
+
 namespace impl {
 inline ::VkResult create_graphics_pipeline_adapter(
     ::VkDevice device,                           //
@@ -941,6 +1138,48 @@ using GraphicsPipelineBase =                          //
             ::VkPipeline,                             //
             ::vkDestroyPipeline>>;
 
+namespace impl {
+inline ::VkResult create_compute_pipeline_adapter(
+    ::VkDevice device,                          //
+    const ::VkComputePipelineCreateInfo& info,  //
+    ::VkPipeline& handle) {
+  return ::vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                    std::addressof(info), ALLOCATOR,
+                                    std::addressof(handle));
+}
+}  // namespace impl
+
+using ComputePipelineBase =                           //
+    impl::ParentedHandleBase<                         //
+        ::VkDevice,                                   //
+        ::VkPipeline,                                 //
+        ::VkComputePipelineCreateInfo,                //
+        ComputePipelineCreateInfo,                    //
+        impl::create_compute_pipeline_adapter,        //
+        impl::close_parented_handle_default_adapter<  //
+            ::VkDevice,                               //
+            ::VkPipeline,                             //
+            ::vkDestroyPipeline>>;
+
+using DescriptorSetLayoutBase =               //
+    impl::DefaultParentedHandleResourceBase<  //
+        ::VkDevice,                           //
+        ::VkDescriptorSetLayout,              //
+        ::VkDescriptorSetLayoutCreateInfo,    //
+        DescriptorSetLayoutCreateInfo,        //
+        ::vkCreateDescriptorSetLayout,        //
+        ::vkDestroyDescriptorSetLayout>;
+
+// Sets allocated from the pool are freed with it.
+using DescriptorPoolBase =                    //
+    impl::DefaultParentedHandleResourceBase<  //
+        ::VkDevice,                           //
+        ::VkDescriptorPool,                   //
+        ::VkDescriptorPoolCreateInfo,         //
+        DescriptorPoolCreateInfo,             //
+        ::vkCreateDescriptorPool,             //
+        ::vkDestroyDescriptorPool>;
+
 //------------------------------------------------------------------------------
 
 DERIVE_FINAL_WITH_CONSTRUCTORS(Instance, InstanceBase);
@@ -952,6 +1191,7 @@ DERIVE_FINAL_WITH_CONSTRUCTORS(Queue, QueueBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(DeviceMemory, DeviceMemoryBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(CommandPool, CommandPoolBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(CommandBufferBuilder, CommandBufferBuilderBase);
+DERIVE_FINAL_WITH_CONSTRUCTORS(Image, ImageBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(ImageView, ImageViewBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(RenderPass, RenderPassBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(PipelineLayout, PipelineLayoutBase);
@@ -959,38 +1199,95 @@ DERIVE_FINAL_WITH_CONSTRUCTORS(ShaderModule, ShaderModuleBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(Swapchain, SwapchainBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(Surface, SurfaceBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(Framebuffer, FramebufferBase);
+DERIVE_FINAL_WITH_CONSTRUCTORS(PipelineCache, PipelineCacheBase);
 DERIVE_FINAL_WITH_CONSTRUCTORS(GraphicsPipeline, GraphicsPipelineBase);
+DERIVE_FINAL_WITH_CONSTRUCTORS(ComputePipeline, ComputePipelineBase);
+DERIVE_FINAL_WITH_CONSTRUCTORS(DescriptorSetLayout, DescriptorSetLayoutBase);
+DERIVE_FINAL_WITH_CONSTRUCTORS(DescriptorPool, DescriptorPoolBase);
+
+// As the pipelines' Init Constructors, but looked up in and added to `cache`.
+inline GraphicsPipeline create_graphics_pipeline(
+    ::VkDevice device,                           //
+    ::VkPipelineCache cache,                     //
+    const ::VkGraphicsPipelineCreateInfo& info) {
+  GraphicsPipelineCreateInfo typed_info{info};
+  ::VkPipeline handle = VK_NULL_HANDLE;
+  ::VkResult result = ::vkCreateGraphicsPipelines(
+      device, cache, 1, typed_info.address(), ALLOCATOR, &handle);
+  CHECK_POSTCONDITION(result == VK_SUCCESS);
+  return GraphicsPipeline{device, handle};
+}
+
+inline ComputePipeline create_compute_pipeline(
+    ::VkDevice device,                          //
+    ::VkPipelineCache cache,                    //
+    const ::VkComputePipelineCreateInfo& info) {
+  ComputePipelineCreateInfo typed_info{info};
+  ::VkPipeline handle = VK_NULL_HANDLE;
+  ::VkResult result = ::vkCreateComputePipelines(
+      device, cache, 1, typed_info.address(), ALLOCATOR, &handle);
+  CHECK_POSTCONDITION(result == VK_SUCCESS);
+  return ComputePipeline{device, handle};
+}
 
 //------------------------------------------------------------------------------
 
 namespace impl {
+template <::VkSubpassContents SubpassContents>
 inline ::VkResult begin_render_pass_command_adapter(
     const ::VkRenderPassBeginInfo& info, ::VkCommandBuffer handle) {
-  ::vkCmdBeginRenderPass(handle, std::addressof(info),
-                         VK_SUBPASS_CONTENTS_INLINE);
+  ::vkCmdBeginRenderPass(handle, std::addressof(info), SubpassContents);
   return VK_SUCCESS;
 }
 inline void end_render_pass_command_adapter(::VkCommandBuffer handle) {
   ::vkCmdEndRenderPass(handle);
 }
-}  // namespace impl
 
-using RenderPassCommandBuilderBase =              //
-    impl::HandleBase<                             //
-        CommandBufferBuilder,                     //
-        ::VkRenderPassBeginInfo,                  //
-        RenderPassBeginInfo,                      //
-        impl::begin_render_pass_command_adapter,  //
-        impl::end_render_pass_command_adapter>;
+inline ::VkDeviceSize index_type_byte_count(::VkIndexType index_type) {
+  switch (index_type) {
+    case VK_INDEX_TYPE_UINT16:
+      return 2;
+    case VK_INDEX_TYPE_UINT32:
+      return 4;
+    default:
+      return 1;
+  }
+}
 
-class RenderPassCommandBuilder final : public RenderPassCommandBuilderBase {
-  using BaseType = RenderPassCommandBuilderBase;
+// Index buffer offsets must be a multiple of the index size.
+inline bool is_valid_index_buffer_offset(::VkDeviceSize byte_offset,  //
+                                         ::VkIndexType index_type) {
+  return byte_offset % index_type_byte_count(index_type) == 0;
+}
 
- public:
-  using BaseType::BaseType;
+// Indirect offsets must be 4-byte aligned, and a stride must be too and cover
+// a whole command whenever more than one command is read.
+inline bool is_valid_indirect_layout(::VkDeviceSize byte_offset,  //
+                                     std::uint32_t draw_count,    //
+                                     std::uint32_t byte_stride,   //
+                                     std::size_t command_byte_count) {
+  return byte_offset % 4 == 0 &&
+         (draw_count <= 1 ||
+          (byte_stride % 4 == 0 && byte_stride >= command_byte_count));
+}
 
+// Draw state and draw commands, shared by builders that record inside a render
+// pass.
+template <typename DerivedType>
+class DrawCommandRecorderBase {
+ public:
   void bind_pipeline(::VkPipeline pipeline) {
-    ::vkCmdBindPipeline(handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    ::vkCmdBindPipeline(command_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        pipeline);
+  }
+
+  // Only for pipelines that leave viewport and scissor dynamic.
+  void set_viewport(const ::VkViewport& viewport) {
+    ::vkCmdSetViewport(command_buffer(), 0, 1, std::addressof(viewport));
+  }
+
+  void set_scissor(const ::VkRect2D& scissor) {
+    ::vkCmdSetScissor(command_buffer(), 0, 1, std::addressof(scissor));
   }
 
   void bind_vertex_buffers(std::uint32_t vertex_buffer_binding,
@@ -998,7 +1295,7 @@ class RenderPassCommandBuilder final : public RenderPassCommandBuilderBase {
                            std::span<::VkDeviceSize> vertex_buffer_offsets) {
     CHECK_PRECONDITION(vertex_buffers.size() == vertex_buffer_offsets.size());
     ::vkCmdBindVertexBuffers(
-        handle(),                                           //
+        command_buffer(),                                   //
         vertex_buffer_binding,                              //
         narrow_cast<std::uint32_t>(vertex_buffers.size()),  //
         vertex_buffers.data(),                              //
@@ -1007,9 +1304,224 @@ class RenderPassCommandBuilder final : public RenderPassCommandBuilderBase {
 
   void draw(std::uint32_t vertex_count, std::uint32_t instance_count = 1,
             std::uint32_t first_vertex = 0, std::uint32_t first_instance = 0) {
-    ::vkCmdDraw(handle(), vertex_count, instance_count, first_vertex,
+    ::vkCmdDraw(command_buffer(), vertex_count, instance_count, first_vertex,
                 first_instance);
   }
+
+  void bind_index_buffer(::VkBuffer index_buffer,     //
+                         ::VkDeviceSize byte_offset,  //
+                         ::VkIndexType index_type) {
+    CHECK_PRECONDITION(index_buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(is_valid_index_buffer_offset(byte_offset, index_type));
+    ::vkCmdBindIndexBuffer(command_buffer(), index_buffer, byte_offset,
+                           index_type);
+  }
+
+  void draw_indexed(std::uint32_t index_count,
+                    std::uint32_t instance_count = 1,
+                    std::uint32_t first_index = 0,
+                    std::int32_t vertex_offset = 0,
+                    std::uint32_t first_instance = 0) {
+    ::vkCmdDrawIndexed(command_buffer(), index_count, instance_count,
+                       first_index, vertex_offset, first_instance);
+  }
+
+  // Reads `draw_count` `VkDrawIndirectCommand`s from `buffer`.
+  void draw_indirect(
+      ::VkBuffer buffer,           //
+      ::VkDeviceSize byte_offset,  //
+      std::uint32_t draw_count,    //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndirectCommand)) {
+    CHECK_PRECONDITION(buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(is_valid_indirect_layout(
+        byte_offset, draw_count, byte_stride, sizeof(::VkDrawIndirectCommand)));
+    ::vkCmdDrawIndirect(command_buffer(), buffer, byte_offset, draw_count,
+                        byte_stride);
+  }
+
+  // Reads `draw_count` `VkDrawIndexedIndirectCommand`s from `buffer`.
+  void draw_indexed_indirect(
+      ::VkBuffer buffer,           //
+      ::VkDeviceSize byte_offset,  //
+      std::uint32_t draw_count,    //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndexedIndirectCommand)) {
+    CHECK_PRECONDITION(buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(
+        is_valid_indirect_layout(byte_offset, draw_count, byte_stride,
+                                 sizeof(::VkDrawIndexedIndirectCommand)));
+    ::vkCmdDrawIndexedIndirect(command_buffer(), buffer, byte_offset,
+                               draw_count, byte_stride);
+  }
+
+  // As `draw_indirect`, but the draw count is read from `count_buffer` on the
+  // device and clamped to `max_draw_count`. Needs `drawIndirectCount`.
+  void draw_indirect_count(
+      ::VkBuffer buffer,                 //
+      ::VkDeviceSize byte_offset,        //
+      ::VkBuffer count_buffer,           //
+      ::VkDeviceSize count_byte_offset,  //
+      std::uint32_t max_draw_count,      //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndirectCommand)) {
+    CHECK_PRECONDITION(buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(count_buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(count_byte_offset % 4 == 0);
+    CHECK_PRECONDITION(is_valid_indirect_layout(
+        byte_offset, max_draw_count, byte_stride,
+        sizeof(::VkDrawIndirectCommand)));
+    ::vkCmdDrawIndirectCount(command_buffer(), buffer, byte_offset,
+                             count_buffer, count_byte_offset, max_draw_count,
+                             byte_stride);
+  }
+
+  // As `draw_indexed_indirect`, but the draw count is read from
+  // `count_buffer` on the device and clamped to `max_draw_count`. Needs
+  // `drawIndirectCount`.
+  void draw_indexed_indirect_count(
+      ::VkBuffer buffer,                 //
+      ::VkDeviceSize byte_offset,        //
+      ::VkBuffer count_buffer,           //
+      ::VkDeviceSize count_byte_offset,  //
+      std::uint32_t max_draw_count,      //
+      std::uint32_t byte_stride = sizeof(::VkDrawIndexedIndirectCommand)) {
+    CHECK_PRECONDITION(buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(count_buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(count_byte_offset % 4 == 0);
+    CHECK_PRECONDITION(
+        is_valid_indirect_layout(byte_offset, max_draw_count, byte_stride,
+                                 sizeof(::VkDrawIndexedIndirectCommand)));
+    ::vkCmdDrawIndexedIndirectCount(command_buffer(), buffer, byte_offset,
+                                    count_buffer, count_byte_offset,
+                                    max_draw_count, byte_stride);
+  }
+
+ private:
+  ::VkCommandBuffer command_buffer() const {
+    return static_cast<const DerivedType&>(*this).handle();
+  }
+};
+}  // namespace impl
+
+using RenderPassCommandBuilderBase =              //
+    impl::HandleBase<                             //
+        CommandBufferBuilder,                     //
+        ::VkRenderPassBeginInfo,                  //
+        RenderPassBeginInfo,                      //
+        impl::begin_render_pass_command_adapter<  //
+            VK_SUBPASS_CONTENTS_INLINE>,          //
+        impl::end_render_pass_command_adapter>;
+
+using RenderPassExecuteCommandBuilderBase =                  //
+    impl::HandleBase<                                        //
+        CommandBufferBuilder,                                //
+        ::VkRenderPassBeginInfo,                             //
+        RenderPassBeginInfo,                                 //
+        impl::begin_render_pass_command_adapter<             //
+            VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS>,  //
+        impl::end_render_pass_command_adapter>;
+
+// Records draws directly into the primary command buffer.
+class RenderPassCommandBuilder final
+    : public RenderPassCommandBuilderBase,
+      public impl::DrawCommandRecorderBase<RenderPassCommandBuilder> {
+  using BaseType = RenderPassCommandBuilderBase;
+
+ public:
+  using BaseType::BaseType;
+};
+
+// Render pass whose contents are recorded in secondary command buffers.
+class RenderPassExecuteCommandBuilder final
+    : public RenderPassExecuteCommandBuilderBase {
+  using BaseType = RenderPassExecuteCommandBuilderBase;
+
+ public:
+  using BaseType::BaseType;
+
+  void execute(std::span<const ::VkCommandBuffer> secondary_command_buffers) {
+    if (secondary_command_buffers.size()) {
+      ::vkCmdExecuteCommands(
+          handle(),                                                      //
+          narrow_cast<std::uint32_t>(secondary_command_buffers.size()),  //
+          secondary_command_buffers.data());
+    }
+  }
+};
+
+// Records draws into a secondary command buffer that continues a render pass;
+// begin info must carry `VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT` and
+// inheritance info.
+class SecondaryCommandBufferBuilder final
+    : public CommandBufferBuilderBase,
+      public impl::DrawCommandRecorderBase<SecondaryCommandBufferBuilder> {
+  using BaseType = CommandBufferBuilderBase;
+
+ public:
+  using BaseType::BaseType;
+};
+
+namespace impl {
+// Compute state and dispatch commands, shared by builders that record compute
+// work.
+template <typename DerivedType>
+class ComputeCommandRecorderBase {
+ public:
+  void bind_pipeline(::VkPipeline pipeline) {
+    ::vkCmdBindPipeline(command_buffer(), VK_PIPELINE_BIND_POINT_COMPUTE,
+                        pipeline);
+  }
+
+  void bind_descriptor_sets(
+      ::VkPipelineLayout pipeline_layout,                  //
+      std::uint32_t first_set,                             //
+      std::span<const ::VkDescriptorSet> descriptor_sets,  //
+      std::span<const std::uint32_t> dynamic_offsets = {}) {
+    ::vkCmdBindDescriptorSets(
+        command_buffer(), VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout,
+        first_set, narrow_cast<std::uint32_t>(descriptor_sets.size()),
+        descriptor_sets.data(),
+        narrow_cast<std::uint32_t>(dynamic_offsets.size()),
+        dynamic_offsets.data());
+  }
+
+  void push_constants(::VkPipelineLayout pipeline_layout,  //
+                      std::uint32_t byte_offset,           //
+                      std::span<const std::byte> bytes) {
+    CHECK_PRECONDITION(byte_offset % 4 == 0);
+    CHECK_PRECONDITION(bytes.size() % 4 == 0);
+    ::vkCmdPushConstants(command_buffer(), pipeline_layout,
+                         VK_SHADER_STAGE_COMPUTE_BIT, byte_offset,
+                         narrow_cast<std::uint32_t>(bytes.size()),
+                         bytes.data());
+  }
+
+  void dispatch(std::uint32_t group_count_x, std::uint32_t group_count_y = 1,
+                std::uint32_t group_count_z = 1) {
+    ::vkCmdDispatch(command_buffer(), group_count_x, group_count_y,
+                    group_count_z);
+  }
+
+  // Reads a `VkDispatchIndirectCommand` from `buffer`.
+  void dispatch_indirect(::VkBuffer buffer, ::VkDeviceSize byte_offset) {
+    CHECK_PRECONDITION(buffer != VK_NULL_HANDLE);
+    CHECK_PRECONDITION(byte_offset % 4 == 0);
+    ::vkCmdDispatchIndirect(command_buffer(), buffer, byte_offset);
+  }
+
+ private:
+  ::VkCommandBuffer command_buffer() const {
+    return static_cast<const DerivedType&>(*this).handle();
+  }
+};
+}  // namespace impl
+
+// Records compute work into a command buffer, outside any render pass.
+class ComputeCommandBuilder final
+    : public CommandBufferBuilderBase,
+      public impl::ComputeCommandRecorderBase<ComputeCommandBuilder> {
+  using BaseType = CommandBufferBuilderBase;
+
+ public:
+  using BaseType::BaseType;
 };
 
 //------------------------------------------------------------------------------
@@ -1046,16 +1558,22 @@ class CommandBufferBlock final {
       : device_{device}, info_{info} {
     CHECK_PRECONDITION(device_ != VK_NULL_HANDLE);
     pool_ = info.commandPool;
-    block_.resize(info.commandBufferCount);
-    ::VkResult result =
-        ::vkAllocateCommandBuffers(device_, info_.address(), block_.data());
-    CHECK_POSTCONDITION(result == VK_SUCCESS);
+    if (info.commandBufferCount) {  // Zero is not a valid allocation count.
+      block_.resize(info.commandBufferCount);
+      ::VkResult result =
+          ::vkAllocateCommandBuffers(device_, info_.address(), block_.data());
+      CHECK_POSTCONDITION(result == VK_SUCCESS);
+    }
   }
 
   explicit operator bool() const { return device_ != VK_NULL_HANDLE; }
 
   const ::VkCommandBufferAllocateInfo& info() const { return info_(); }
 
+  std::uint32_t size() const {
+    return narrow_cast<std::uint32_t>(block_.size());
+  }
+
   void acquire_command_buffers(std::uint32_t next_count) {
     auto curr_count = narrow_cast<std::uint32_t>(block_.size());
     if (curr_count < next_count) {
@@ -1064,7 +1582,7 @@ class CommandBufferBlock final {
       ::VkCommandBufferAllocateInfo delta_info{
           .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
           .commandPool = pool_,
-          .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+          .level = info_().level,
           .commandBufferCount = next_count - curr_count,
       };
       ::VkResult result = ::vkAllocateCommandBuffers(
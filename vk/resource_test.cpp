@@ -1,5 +1,6 @@
 #include "vk/resource.hpp"
 
+#include "lib/allocation_counter.hpp"
 #include "lib/testing.hpp"
 
 namespace volcano::vk {
@@ -186,6 +187,39 @@ TEST_CASE("PipelineLayoutCreateInfo") {
   }
 }
 
+TEST_CASE("ComputePipelineCreateInfo") {
+  ComputePipelineCreateInfo info;
+
+  SECTION("ShoulHaveTypeValue") {
+    REQUIRE(info().sType == VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO);
+  }
+
+  SECTION("ShoulHaveAddressToVkStructure") {
+    // Under Test.
+    ::VkComputePipelineCreateInfo* address = info.address();
+
+    // Postcondition.
+    REQUIRE(address != nullptr);
+  }
+}
+
+TEST_CASE("DescriptorSetLayoutCreateInfo") {
+  DescriptorSetLayoutCreateInfo info;
+
+  SECTION("ShoulHaveTypeValue") {
+    REQUIRE(info().sType ==
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
+  }
+
+  SECTION("ShoulHaveAddressToVkStructure") {
+    // Under Test.
+    ::VkDescriptorSetLayoutCreateInfo* address = info.address();
+
+    // Postcondition.
+    REQUIRE(address != nullptr);
+  }
+}
+
 TEST_CASE("ShaderModuleCreateInfo") {
   ShaderModuleCreateInfo info;
 
@@ -218,10 +252,89 @@ TEST_CASE("SwapchainCreateInfo") {
   }
 }
 
+TEST_CASE("SubmitInfo") {
+  SubmitInfo info{::VkSubmitInfo{.commandBufferCount = 1}};
+
+  SECTION("ShoulHaveTypeValue") {
+    REQUIRE(info().sType == VK_STRUCTURE_TYPE_SUBMIT_INFO);
+  }
+
+  SECTION("ShoulKeepValueAfterMove") {
+    // Under Test.
+    SubmitInfo moved = std::move(info);
+
+    // Postcondition.
+    REQUIRE(moved.address() != nullptr);
+    REQUIRE(moved().sType == VK_STRUCTURE_TYPE_SUBMIT_INFO);
+    REQUIRE(moved().commandBufferCount == 1);
+  }
+}
+
+TEST_CASE("PooledBoxStorage") {
+  SECTION("ShouldReuseReleasedStorage") {
+    // Precondition.
+    ::VkApplicationInfo* prev_address = nullptr;
+    {
+      ApplicationInfo info;
+      prev_address = info.address();
+    }
+
+    // Under Test.
+    ApplicationInfo info;
+
+    // Postcondition.
+    REQUIRE(info.address() == prev_address);
+    REQUIRE(info().sType == VK_STRUCTURE_TYPE_APPLICATION_INFO);
+  }
+
+  SECTION("ShouldNotAllocateInSteadyState") {
+    // Precondition.
+    { ApplicationInfo warm_up; }
+
+    // Under Test.
+    ScopedAllocationCount allocations;
+    for (int frame = 0; frame < 100; ++frame) {
+      ApplicationInfo info;
+      ApplicationInfo moved = std::move(info);
+    }
+
+    // Postcondition.
+    REQUIRE(allocations.count() == 0);
+  }
+
+  SECTION("ShouldHaveDistinctAddresses") {
+    // Under Test.
+    std::vector<ApplicationInfo> infos(100);
+
+    // Postcondition.
+    for (std::size_t i = 1; i < infos.size(); ++i) {
+      REQUIRE(infos[i].address() != infos[i - 1].address());
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 
 const std::string VALIDATION_LAYER{"VK_LAYER_KHRONOS_validation"};
 
+TEST_CASE("IndirectLayout") {
+  SECTION("ShouldRequireAlignedOffset") {
+    REQUIRE(impl::is_valid_indirect_layout(16, 1, 0, 16));
+    REQUIRE_FALSE(impl::is_valid_indirect_layout(2, 1, 0, 16));
+  }
+
+  SECTION("ShouldIgnoreStrideForSingleDraw") {
+    REQUIRE(impl::is_valid_indirect_layout(0, 1, 3, 16));
+  }
+
+  SECTION("ShouldRequireStrideCoveringCommand") {
+    REQUIRE(impl::is_valid_indirect_layout(0, 2, 16, 16));
+    REQUIRE(impl::is_valid_indirect_layout(0, 2, 32, 16));
+    REQUIRE_FALSE(impl::is_valid_indirect_layout(0, 2, 12, 16));
+    REQUIRE_FALSE(impl::is_valid_indirect_layout(0, 2, 18, 16));
+  }
+}
+
 TEST_CASE("InstanceLayerProperties") {
   InstanceLayerProperties enumerated;
 
@@ -282,7 +395,7 @@ TEST_CASE("Instance Handle") {
 
   SECTION("ShoulHaveValidCreateInfo") {
     // Under Test.
-    REQUIRE(handle.create_info().pApplicationInfo == app_info.address());
+    REQUIRE(handle.info().pApplicationInfo == app_info.address());
   }
 }
 